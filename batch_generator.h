@@ -0,0 +1,293 @@
+#ifndef BATCH_GENERATOR_H
+#define BATCH_GENERATOR_H
+
+#include "board.h"
+#include "board_generator.h"
+#include "bounded_queue.h"
+#include "constrained_board.h"
+#include "corpus.h"
+#include "puzzle_text.h"
+#include "solver.h"
+#include "sum_generator.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace kakuro {
+
+enum class BatchFormat {
+  kText, // the text format of WritePuzzleText
+  kCorpus, // a binary corpus as written by CorpusWriter, which needs a seekable output
+};
+
+struct BatchOptions {
+  int count = 1; // number of puzzles to write
+  int minSize = 10; // rows and columns are each picked from [minSize, maxSize] per puzzle
+  int maxSize = 20;
+  unsigned firstSeed = 0; // every seed in [firstSeed, lastSeed] is tried at most once
+  unsigned lastSeed = 0;
+  double blockProbability = 0.3;
+  bool withSolution = true;
+  BatchFormat format = BatchFormat::kText;
+
+  // Search budget for generating the sums of a single layout, beyond which the layout is dropped so
+  // that it can't stall its worker. It is counted in nodes rather than time so that the puzzles
+  // only depend on their seeds.
+  SolveBudget sumBudget{/* maxNodes */ 2000000};
+
+  // Worker threads per pipeline stage.
+  int layoutThreads = 1;
+  int sumThreads = 1;
+  int verifyThreads = 1;
+  int serializeThreads = 1;
+
+  std::size_t queueCapacity = 16; // puzzles that may wait between two stages
+};
+
+struct BatchResult {
+  int numWritten = 0;
+  int numSeedsTried = 0;
+  int numFailedSums = 0; // layouts for which no sums could be generated
+  int numSumsOverBudget = 0; // layouts dropped because generating their sums exceeded the budget
+  int numNotUnique = 0; // puzzles that had more than one solution
+};
+
+// Generates a batch of puzzles with a pipeline of layout generation, sum generation, uniqueness
+// verification and serialization. Each stage runs on its own worker threads and hands puzzles to
+// the next through a bounded queue. Every puzzle is generated from its own seed, and finished
+// puzzles wait in a reorder buffer until all lower seeds are done, so the batch always consists of
+// the puzzles of the lowest accepted seeds in seed order, no matter how many threads are used.
+class BatchGenerator {
+public:
+  BatchGenerator(const BatchOptions& options) : options_{options} {
+    assert(options_.count > 0);
+    assert(options_.minSize >= 2);
+    assert(options_.minSize <= options_.maxSize);
+    assert(options_.firstSeed <= options_.lastSeed);
+  }
+
+  // Writes the puzzles to the output in the configured format. Stops early if all seeds were tried
+  // before enough puzzles were found.
+  BatchResult Generate(std::ostream& output) {
+    output_ = &output;
+    std::optional<CorpusWriter> corpusWriter;
+    if (options_.format == BatchFormat::kCorpus) {
+      corpusWriter.emplace(output);
+    }
+    corpusWriter_ = corpusWriter ? &*corpusWriter : nullptr;
+    nextSeed_ = options_.firstSeed;
+    seedsExhausted_ = false;
+    numWritten_ = 0;
+    nextSeedToWrite_ = options_.firstSeed;
+    reorderBuffer_.clear();
+    numFailedSums_ = 0;
+    numSumsOverBudget_ = 0;
+    numNotUnique_ = 0;
+
+    BoundedQueue<BatchPuzzle> layouts{options_.queueCapacity};
+    BoundedQueue<BatchPuzzle> puzzles{options_.queueCapacity};
+    BoundedQueue<BatchPuzzle> verifiedPuzzles{options_.queueCapacity};
+
+    auto layoutWorkers = StartWorkers(options_.layoutThreads, [&] { GenerateLayouts(layouts); });
+    auto sumWorkers = StartWorkers(options_.sumThreads, [&] { GenerateSums(layouts, puzzles); });
+    auto verifyWorkers =
+        StartWorkers(options_.verifyThreads, [&] { VerifyPuzzles(puzzles, verifiedPuzzles); });
+    auto serializeWorkers =
+        StartWorkers(options_.serializeThreads, [&] { SerializePuzzles(verifiedPuzzles); });
+
+    // Once all workers of a stage are done, the next stage can finish the remaining puzzles.
+    JoinWorkers(layoutWorkers);
+    layouts.Close();
+    JoinWorkers(sumWorkers);
+    puzzles.Close();
+    JoinWorkers(verifyWorkers);
+    verifiedPuzzles.Close();
+    JoinWorkers(serializeWorkers);
+
+    if (corpusWriter_ != nullptr) {
+      corpusWriter_->Finish();
+      corpusWriter_ = nullptr;
+    }
+    output_->flush();
+    BatchResult result;
+    result.numWritten = numWritten_;
+    result.numSeedsTried = nextSeed_ - options_.firstSeed + seedsExhausted_;
+    result.numFailedSums = numFailedSums_;
+    result.numSumsOverBudget = numSumsOverBudget_;
+    result.numNotUnique = numNotUnique_;
+    return result;
+  }
+
+private:
+  struct BatchPuzzle {
+    unsigned seed;
+    Board board;
+  };
+
+  // A puzzle that is ready to be written, encoded in the output format.
+  struct EncodedPuzzle {
+    int rows;
+    int columns;
+    std::string data;
+  };
+
+  template <typename Work>
+  std::vector<std::thread> StartWorkers(int numWorkers, Work work) {
+    assert(numWorkers > 0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numWorkers; i++) {
+      workers.emplace_back(work);
+    }
+    return workers;
+  }
+
+  void JoinWorkers(std::vector<std::thread>& workers) {
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  bool Done() const { return numWritten_.load(std::memory_order_relaxed) >= options_.count; }
+
+  // Hands out the next untried seed, or nothing once all were tried.
+  std::optional<unsigned> NextSeed() {
+    std::lock_guard<std::mutex> lock{seedMutex_};
+    if (seedsExhausted_) {
+      return std::nullopt;
+    }
+    unsigned seed = nextSeed_;
+    if (seed == options_.lastSeed) {
+      seedsExhausted_ = true;
+    } else {
+      nextSeed_++;
+    }
+    return seed;
+  }
+
+  void GenerateLayouts(BoundedQueue<BatchPuzzle>& layouts) {
+    while (!Done()) {
+      auto seed = NextSeed();
+      if (!seed) {
+        return;
+      }
+
+      std::mt19937 random;
+      random.seed(*seed);
+      std::uniform_int_distribution<int> sizeDistribution{options_.minSize, options_.maxSize};
+      int rows = sizeDistribution(random);
+      int columns = sizeDistribution(random);
+      BoardGenerator boardGenerator{random, options_.blockProbability};
+      if (!layouts.Push(BatchPuzzle{*seed, boardGenerator.Generate(rows, columns)})) {
+        return;
+      }
+    }
+  }
+
+  void GenerateSums(BoundedQueue<BatchPuzzle>& layouts, BoundedQueue<BatchPuzzle>& puzzles) {
+    while (auto puzzle = layouts.Pop()) {
+      if (Done()) {
+        continue; // drain the queue
+      }
+
+      ConstrainedBoard constrainedBoard{puzzle->board};
+      SumGenerator sumGenerator{/* verboseLogs */ false};
+      sumGenerator.SetBudget(options_.sumBudget);
+      if (!sumGenerator.GenerateSums(constrainedBoard)) {
+        if (sumGenerator.BudgetExceeded()) {
+          numSumsOverBudget_++;
+        } else {
+          numFailedSums_++;
+        }
+        Finish(puzzle->seed, std::nullopt);
+        continue;
+      }
+      puzzles.Push(std::move(*puzzle));
+    }
+  }
+
+  void VerifyPuzzles(BoundedQueue<BatchPuzzle>& puzzles, BoundedQueue<BatchPuzzle>& verified) {
+    while (auto puzzle = puzzles.Pop()) {
+      if (Done()) {
+        continue; // drain the queue
+      }
+
+      // The generated sums come with their solution filled in, so verify on an empty copy.
+      Board board = puzzle->board;
+      for (int i = 0; i < board.Rows() * board.Columns(); i++) {
+        if (board[i].IsFilled()) {
+          board.SetNumber(board[i], 0);
+        }
+      }
+      ConstrainedBoard constrainedBoard{board};
+      Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+      if (solver.CountSolutions(constrainedBoard, /* limit */ 2) != 1) {
+        numNotUnique_++;
+        Finish(puzzle->seed, std::nullopt);
+        continue;
+      }
+      verified.Push(std::move(*puzzle));
+    }
+  }
+
+  void SerializePuzzles(BoundedQueue<BatchPuzzle>& verified) {
+    std::ostringstream text;
+    while (auto puzzle = verified.Pop()) {
+      // Format outside of the lock, so that only the actual writes are serialized.
+      const Board& board = puzzle->board;
+      EncodedPuzzle encoded{board.Rows(), board.Columns(), {}};
+      if (corpusWriter_ != nullptr) {
+        encoded.data = CorpusWriter::Encode(board, options_.withSolution);
+      } else {
+        text.str("");
+        WritePuzzleText(board, text, options_.withSolution);
+        encoded.data = text.str();
+      }
+      Finish(puzzle->seed, std::move(encoded));
+    }
+  }
+
+  // Records the outcome of a seed, which is nothing if its puzzle was dropped, and writes out all
+  // puzzles whose lower seeds are finished as well.
+  void Finish(unsigned seed, std::optional<EncodedPuzzle> puzzle) {
+    std::lock_guard<std::mutex> lock{outputMutex_};
+    reorderBuffer_.emplace(seed, std::move(puzzle));
+    for (auto iter = reorderBuffer_.begin();
+         iter != reorderBuffer_.end() && iter->first == nextSeedToWrite_;
+         iter = reorderBuffer_.erase(iter)) {
+      if (iter->second && numWritten_ < options_.count) {
+        if (corpusWriter_ != nullptr) {
+          corpusWriter_->AddEncoded(iter->second->rows, iter->second->columns, iter->first,
+              options_.withSolution, iter->second->data);
+        } else {
+          *output_ << iter->second->data;
+        }
+        numWritten_++;
+      }
+      nextSeedToWrite_++;
+    }
+  }
+
+  BatchOptions options_;
+  std::ostream* output_;
+  CorpusWriter* corpusWriter_;
+  std::mutex seedMutex_;
+  unsigned nextSeed_;
+  bool seedsExhausted_;
+  std::mutex outputMutex_;
+  unsigned nextSeedToWrite_; // guarded by outputMutex_, like reorderBuffer_
+  std::map<unsigned, std::optional<EncodedPuzzle>> reorderBuffer_;
+  std::atomic<int> numWritten_;
+  std::atomic<int> numFailedSums_;
+  std::atomic<int> numSumsOverBudget_;
+  std::atomic<int> numNotUnique_;
+};
+
+} // namespace kakuro
+
+#endif
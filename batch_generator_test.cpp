@@ -0,0 +1,133 @@
+#include "batch_generator.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace kakuro;
+
+namespace {
+int CountPuzzles(const std::string& text) {
+  int numPuzzles = 0;
+  std::istringstream input{text};
+  std::string line;
+  while (std::getline(input, line)) {
+    numPuzzles += line.rfind("kakuro ", 0) == 0;
+  }
+  return numPuzzles;
+}
+} // namespace
+
+TEST(BatchGeneratorTest, Generate) {
+  // Most generated sums don't have a unique solution, but one of these seeds does.
+  BatchOptions options;
+  options.count = 1;
+  options.minSize = 5;
+  options.maxSize = 8;
+  options.firstSeed = 0;
+  options.lastSeed = 20;
+  options.layoutThreads = 2;
+  options.sumThreads = 2;
+  options.verifyThreads = 2;
+  options.serializeThreads = 2;
+  options.queueCapacity = 1;
+
+  std::ostringstream output;
+  BatchGenerator batchGenerator{options};
+  auto result = batchGenerator.Generate(output);
+  ASSERT_EQ(result.numWritten, 1);
+  ASSERT_EQ(CountPuzzles(output.str()), 1);
+}
+
+TEST(BatchGeneratorTest, IndependentOfThreads) {
+  BatchOptions options;
+  options.count = 2;
+  options.minSize = 5;
+  options.maxSize = 8;
+  options.firstSeed = 65;
+  options.lastSeed = 80;
+
+  std::ostringstream sequentialOutput;
+  BatchGenerator sequentialGenerator{options};
+  auto sequentialResult = sequentialGenerator.Generate(sequentialOutput);
+
+  options.layoutThreads = 3;
+  options.sumThreads = 3;
+  options.verifyThreads = 3;
+  options.serializeThreads = 3;
+  options.queueCapacity = 1;
+  std::ostringstream parallelOutput;
+  BatchGenerator parallelGenerator{options};
+  auto parallelResult = parallelGenerator.Generate(parallelOutput);
+
+  // Puzzles that finish early must wait for lower seeds, so both pick the same ones in seed order.
+  ASSERT_EQ(sequentialResult.numWritten, 2);
+  ASSERT_EQ(parallelResult.numWritten, 2);
+  ASSERT_EQ(parallelOutput.str(), sequentialOutput.str());
+}
+
+TEST(BatchGeneratorTest, SeedsExhausted) {
+  BatchOptions options;
+  options.count = 100;
+  options.minSize = 5;
+  options.maxSize = 5;
+  options.firstSeed = 10;
+  options.lastSeed = 12;
+
+  std::ostringstream output;
+  BatchGenerator batchGenerator{options};
+  auto result = batchGenerator.Generate(output);
+  ASSERT_EQ(result.numSeedsTried, 3);
+  ASSERT_EQ(
+      result.numWritten + result.numFailedSums + result.numSumsOverBudget + result.numNotUnique, 3);
+  ASSERT_EQ(CountPuzzles(output.str()), result.numWritten);
+}
+
+TEST(BatchGeneratorTest, SumBudget) {
+  BatchOptions options;
+  options.count = 100;
+  options.minSize = 8;
+  options.maxSize = 8;
+  options.firstSeed = 0;
+  options.lastSeed = 4;
+  options.sumBudget.maxNodes = 1;
+
+  std::ostringstream output;
+  BatchGenerator batchGenerator{options};
+  auto result = batchGenerator.Generate(output);
+  ASSERT_EQ(result.numSeedsTried, 5);
+  ASSERT_EQ(result.numSumsOverBudget, 5);
+  ASSERT_EQ(result.numWritten, 0);
+}
+
+TEST(BatchGeneratorTest, GenerateCorpus) {
+  BatchOptions options;
+  options.count = 1;
+  options.minSize = 5;
+  options.maxSize = 8;
+  options.firstSeed = 0;
+  options.lastSeed = 20;
+  options.format = BatchFormat::kCorpus;
+
+  std::string filename = testing::TempDir() + "batch_generator_test.kkc";
+  BatchResult result;
+  {
+    std::ofstream output{filename, std::ios::out | std::ios::binary};
+    BatchGenerator batchGenerator{options};
+    result = batchGenerator.Generate(output);
+  }
+  ASSERT_EQ(result.numWritten, 1);
+
+  CorpusReader reader;
+  ASSERT_TRUE(reader.Open(filename));
+  ASSERT_EQ(reader.Size(), 1);
+  ASSERT_TRUE(reader[0]);
+  PuzzleView puzzle = *reader[0];
+  ASSERT_TRUE(puzzle.HasSolution());
+  ASSERT_GE(puzzle.Seed(), options.firstSeed);
+  ASSERT_LE(puzzle.Seed(), options.lastSeed);
+  ASSERT_GE(puzzle.Rows(), options.minSize);
+  ASSERT_LE(puzzle.Columns(), options.maxSize);
+}
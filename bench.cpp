@@ -0,0 +1,27 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+// Like BENCHMARK_MAIN, but reports results as JSON unless another format is asked for, so that runs
+// before and after a change can be compared with Google Benchmark's compare.py.
+int main(int argc, char** argv) {
+  std::vector<char*> args{argv, argv + argc};
+  bool hasFormat = false;
+  for (int i = 1; i < argc; i++) {
+    hasFormat = hasFormat || std::strncmp(argv[i], "--benchmark_format=", 19) == 0;
+  }
+  char jsonFormat[] = "--benchmark_format=json";
+  if (!hasFormat) {
+    args.insert(args.begin() + 1, jsonFormat);
+  }
+
+  int numArgs = static_cast<int>(args.size());
+  benchmark::Initialize(&numArgs, args.data());
+  if (benchmark::ReportUnrecognizedArguments(numArgs, args.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
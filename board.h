@@ -2,6 +2,7 @@
 #define BOARD_H
 
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -11,21 +12,23 @@
 
 namespace kakuro {
 
+// Fields use the smallest types that fit boards of up to 32767x32767 cells, which shrinks a cell
+// from 56 to 26 bytes so that much more of a large board stays in cache during propagation.
 struct Cell {
-  int row;
-  int column;
-  int number;
+  int16_t row;
+  int16_t column;
+  int8_t number;
   bool isBlock;
-  int rowBlockRow;
-  int rowBlockColumn;
-  int rowBlockSize;
-  int rowBlockFree;
-  int rowBlockSum;
-  int columnBlockRow;
-  int columnBlockColumn;
-  int columnBlockSize;
-  int columnBlockFree;
-  int columnBlockSum;
+  int16_t rowBlockRow;
+  int16_t rowBlockColumn;
+  int16_t rowBlockSize;
+  int16_t rowBlockFree;
+  int16_t rowBlockSum;
+  int16_t columnBlockRow;
+  int16_t columnBlockColumn;
+  int16_t columnBlockSize;
+  int16_t columnBlockFree;
+  int16_t columnBlockSum;
 
   int RowBlockDistance() const {
     if (isBlock) {
@@ -71,6 +74,9 @@ public:
         columns_{columns},
         numbers_{(rows - 1) * (columns - 1)},
         cells_{static_cast<std::size_t>(rows * columns)} {
+    assert(rows <= INT16_MAX);
+    assert(columns <= INT16_MAX);
+
     for (int row = 0; row < rows_; row++) {
       for (int column = 0; column < columns_; column++) {
         auto& cell = MutableCell(row, column);
@@ -79,12 +85,13 @@ public:
         cell.number = 0;
         cell.isBlock = false;
 
+        // The top left corner is a block without any cells.
         if (column == 0) {
           cell.isBlock = true;
           cell.rowBlockRow = 0;
           cell.rowBlockColumn = 0;
-          cell.rowBlockSize = columns_ - 1;
-          cell.rowBlockFree = columns_ - 1;
+          cell.rowBlockSize = row == 0 ? 0 : columns_ - 1;
+          cell.rowBlockFree = cell.rowBlockSize;
         } else {
           cell.rowBlockRow = row;
           cell.rowBlockColumn = 0;
@@ -96,8 +103,8 @@ public:
           cell.isBlock = true;
           cell.columnBlockRow = 0;
           cell.columnBlockColumn = 0;
-          cell.columnBlockSize = rows_ - 1;
-          cell.columnBlockFree = rows_ - 1;
+          cell.columnBlockSize = column == 0 ? 0 : rows_ - 1;
+          cell.columnBlockFree = cell.columnBlockSize;
         } else {
           cell.columnBlockRow = 0;
           cell.columnBlockColumn = column;
@@ -111,6 +118,78 @@ public:
     }
   }
 
+  // Builds a board from a mask of which cells are blocks, in row-major order, along with optional
+  // block sums and numbers in the same order. Cells in the first row and column are always blocks.
+  // Unlike calling MakeBlock per block, which scans the rest of the row and column each time, this
+  // sets up all block memberships, sizes and free counts in a single sweep over the cells.
+  static Board FromBlockMask(
+      int rows,
+      int columns,
+      const std::vector<bool>& isBlock,
+      const std::vector<uint8_t>& columnBlockSums = {},
+      const std::vector<uint8_t>& rowBlockSums = {},
+      const std::vector<uint8_t>& numbers = {}) {
+    [[maybe_unused]] std::size_t numCells = static_cast<std::size_t>(rows) * columns;
+    assert(isBlock.size() == numCells);
+    assert(columnBlockSums.empty() || columnBlockSums.size() == numCells);
+    assert(rowBlockSums.empty() || rowBlockSums.size() == numCells);
+    assert(numbers.empty() || numbers.size() == numCells);
+
+    Board board{rows, columns, /* numbers */ 0};
+    std::vector<int16_t> columnBlockRows(columns, 0); // the current block of each column
+    for (int row = 0; row < rows; row++) {
+      int rowBlockColumn = 0;
+      for (int column = 0; column < columns; column++) {
+        int index = row * columns + column;
+        Cell& cell = board.cells_[index];
+        cell.row = row;
+        cell.column = column;
+        cell.rowBlockRow = row;
+        cell.rowBlockColumn = rowBlockColumn;
+        cell.rowBlockSize = 0;
+        cell.rowBlockFree = 0;
+        cell.rowBlockSum = 0;
+        cell.columnBlockRow = columnBlockRows[column];
+        cell.columnBlockColumn = column;
+        cell.columnBlockSize = 0;
+        cell.columnBlockFree = 0;
+        cell.columnBlockSum = 0;
+
+        if (row == 0 || column == 0 || isBlock[index]) {
+          cell.isBlock = true;
+          cell.number = 0;
+          if (!columnBlockSums.empty()) {
+            assert(columnBlockSums[index] <= 45);
+            cell.columnBlockSum = columnBlockSums[index];
+          }
+          if (!rowBlockSums.empty()) {
+            assert(rowBlockSums[index] <= 45);
+            cell.rowBlockSum = rowBlockSums[index];
+          }
+          rowBlockColumn = column;
+          columnBlockRows[column] = row;
+          continue;
+        }
+
+        cell.isBlock = false;
+        cell.number = numbers.empty() ? 0 : numbers[index];
+        assert(cell.number >= 0 && cell.number <= 9);
+        board.numbers_++;
+
+        // Blocks come before their cells in row-major order, so they are already set up.
+        Cell& rowBlock = board.cells_[row * columns + rowBlockColumn];
+        Cell& columnBlock = board.cells_[cell.columnBlockRow * columns + column];
+        rowBlock.rowBlockSize++;
+        columnBlock.columnBlockSize++;
+        if (cell.number == 0) {
+          rowBlock.rowBlockFree++;
+          columnBlock.columnBlockFree++;
+        }
+      }
+    }
+    return board;
+  }
+
   int Rows() const { return rows_; }
 
   int Columns() const { return columns_; }
@@ -131,6 +210,8 @@ public:
     return cells_[index];
   }
 
+  int Index(const Cell& cell) const { return cell.row * columns_ + cell.column; }
+
   const Cell& RowBlock(const Cell& cell) const {
     if (cell.isBlock) {
       return cell;
@@ -147,35 +228,25 @@ public:
     return (*this)(cell.columnBlockRow, cell.columnBlockColumn);
   }
 
-  void ForEachBlockCell(
-      const Cell& cell, bool isRow, const std::function<void(const Cell&)>& callback) const {
+  // Visitors are templates rather than std::function so the propagation loops can inline them.
+  template <typename Callback>
+  void ForEachBlockCell(const Cell& cell, bool isRow, Callback&& callback) const {
     assert(cell.isBlock);
 
-    if (isRow) {
-      for (int column = cell.column + 1; column < columns_; column++) {
-        const Cell& currentCell = (*this)(cell.row, column);
-
-        if (currentCell.isBlock) {
-          break;
-        }
-
-        callback(currentCell);
-      }
-    } else {
-      for (int row = cell.row + 1; row < rows_; row++) {
-        const Cell& currentCell = (*this)(row, cell.column);
-
-        if (currentCell.isBlock) {
-          break;
-        }
-
-        callback(currentCell);
-      }
+    // Block sizes are kept up to date by MakeBlock, and the cells of a block are evenly spaced in
+    // cells_, so we can visit them directly instead of scanning for the next block.
+    int size = cell.BlockSize(isRow);
+    int stride = isRow ? 1 : columns_;
+    const Cell* currentCell = &cells_[Index(cell)];
+    for (int i = 0; i < size; i++) {
+      currentCell += stride;
+      assert(!currentCell->isBlock);
+      callback(*currentCell);
     }
   }
 
-  int ForEachNeighborCell(
-      const Cell& cell, const std::function<bool(const Cell&)>& callback) const {
+  template <typename Callback>
+  int ForEachNeighborCell(const Cell& cell, Callback&& callback) const {
     bool isLeftBorder = cell.column == 0;
     bool isTopBorder = cell.row == 0;
     bool isRightBorder = cell.column == Columns() - 1;
@@ -328,7 +399,7 @@ public:
     cell.columnBlockSize = 0;
     cell.columnBlockFree = 0;
     cell.columnBlockSum = 0;
-    ForEachBlockCellMutable(cell, /* isRow */ false, [&cell, &oldColumnBlock](Cell& currentCell) {
+    ScanBlockCellsMutable(cell, /* isRow */ false, [&cell, &oldColumnBlock](Cell& currentCell) {
       currentCell.columnBlockRow = cell.row;
       currentCell.columnBlockColumn = cell.column;
       cell.columnBlockSize++;
@@ -345,7 +416,7 @@ public:
     cell.rowBlockSize = 0;
     cell.rowBlockFree = 0;
     cell.rowBlockSum = 0;
-    ForEachBlockCellMutable(cell, /* isRow */ true, [&cell, &oldRowBlock](Cell& currentCell) {
+    ScanBlockCellsMutable(cell, /* isRow */ true, [&cell, &oldRowBlock](Cell& currentCell) {
       currentCell.rowBlockRow = cell.row;
       currentCell.rowBlockColumn = cell.column;
       cell.rowBlockSize++;
@@ -392,74 +463,17 @@ public:
     }
   }
 
-  void RenderHtml(std::ostream& output) {
-    return RenderHtml(
-        output, [](std::ostream& output, const Cell& cell) { output << cell.number; });
-  }
-
-  void RenderHtml(
-      std::ostream& output, const std::function<void(std::ostream&, const Cell&)>& cellPrinter) {
-    output << "<!doctype html>" << std::endl;
-    output << "<html>" << std::endl;
-    output << "<head>" << std::endl;
-    output << "<meta charset = \"utf-8\">" << std::endl;
-    output << "<title>Karuko</title>" << std::endl;
-    output << "<style type=\"text/css\">" << std::endl;
-    output << "table { border-collapse: collapse }" << std::endl;
-    output << "td { text-align: center; vertical-align: middle; color: black }" << std::endl;
-    output << "td.cell { width: 48px; height: 48px; border: 1px solid black }" << std::endl;
-    output << "input { border: 0px; background: transparent; text-align: center; width: 100%; }"
-           << std::endl;
-    output << "</style>" << std::endl;
-    output << "</head>" << std::endl;
-    output << "<body>" << std::endl;
-    output << "<table>" << std::endl;
-
-    for (int row = 0; row < rows_; row++) {
-      output << "\t<tr>" << std::endl;
-      for (int column = 0; column < columns_; column++) {
-        auto& cell = (*this)(row, column);
-
-        if (cell.isBlock) {
-          auto ifNonZero = [](int i) -> std::string {
-            if (i > 0) {
-              return std::to_string(i);
-            } else {
-              return "&nbsp;";
-            }
-          };
-
-          output << "\t\t<td class=\"cell\" style=\"background-color: black\">" << std::endl;
-          output << "\t\t\t<table style=\"width: 100%; height: 100%;\">" << std::endl;
-          output << "\t\t\t\t<tr>" << std::endl;
-          output << "\t\t\t\t\t<td></td>" << std::endl;
-          output << "\t\t\t\t\t<td style=\"text-align:right;color:white\">"
-                 << ifNonZero(cell.rowBlockSum) << "</td>" << std::endl;
-          output << "\t\t\t\t</tr>" << std::endl;
-          output << "\t\t\t\t<tr>" << std::endl;
-          output << "\t\t\t\t\t<td style=\"text-align:left;color:white\">"
-                 << ifNonZero(cell.columnBlockSum) << "</td>" << std::endl;
-          output << "\t\t\t\t\t<td></td>" << std::endl;
-          output << "\t\t\t\t</tr>" << std::endl;
-          output << "\t\t\t</table>" << std::endl;
-        } else {
-          output << "\t\t<td class=\"cell\">" << std::endl;
-          output << "\t\t\t";
-          cellPrinter(output, cell);
-          output << std::endl;
-        }
-
-        output << "\t\t</td>" << std::endl;
-      }
-      output << "\t</tr>" << std::endl;
-    }
-
-    output << "</table>" << std::endl;
-    output << "</body>" << std::endl;
-    output << "</html>" << std::endl;
+private:
+  // Only allocates the cells, for FromBlockMask to fill in.
+  Board(int rows, int columns, int numbers)
+      : rows_{rows},
+        columns_{columns},
+        numbers_{numbers},
+        cells_{static_cast<std::size_t>(rows * columns)} {
+    assert(rows <= INT16_MAX);
+    assert(columns <= INT16_MAX);
   }
 
-private:
   Cell& MutableCell(const Cell& cell) { return const_cast<Cell&>(cell); }
 
   Cell& MutableCell(int row, int column) {
@@ -492,11 +506,33 @@ private:
     return MutableCell(cell.columnBlockRow, cell.columnBlockColumn);
   }
 
-  void ForEachBlockCellMutable(
-      const Cell& cell, bool isRow, const std::function<void(Cell&)>& callback) {
-    ForEachBlockCell(cell, isRow, [this, &callback](const Cell& currentCell) {
-      callback(MutableCell(currentCell));
-    });
+  // Unlike ForEachBlockCell, this doesn't rely on the block size but scans until the next block, so
+  // MakeBlock can use it to recompute block sizes.
+  template <typename Callback>
+  void ScanBlockCellsMutable(const Cell& cell, bool isRow, Callback&& callback) {
+    assert(cell.isBlock);
+
+    if (isRow) {
+      for (int column = cell.column + 1; column < columns_; column++) {
+        Cell& currentCell = MutableCell(cell.row, column);
+
+        if (currentCell.isBlock) {
+          break;
+        }
+
+        callback(currentCell);
+      }
+    } else {
+      for (int row = cell.row + 1; row < rows_; row++) {
+        Cell& currentCell = MutableCell(row, cell.column);
+
+        if (currentCell.isBlock) {
+          break;
+        }
+
+        callback(currentCell);
+      }
+    }
   }
 
   int rows_;
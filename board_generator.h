@@ -8,12 +8,17 @@ namespace kakuro {
 
 class BoardGenerator {
 public:
-  BoardGenerator(std::mt19937& random, double blockProbability)
-      : random_{random}, blockDistribution_{blockProbability} {}
+  BoardGenerator(
+      std::mt19937& random,
+      double blockProbability,
+      CriticalPathMode criticalPathMode = CriticalPathMode::kArticulationPoints)
+      : random_{random},
+        blockDistribution_{blockProbability},
+        criticalPathMode_{criticalPathMode} {}
 
   Board Generate(int rows, int columns) {
     Board board{rows, columns};
-    CriticalPathFinder criticalPathFinder{board};
+    CriticalPathFinder criticalPathFinder{board, criticalPathMode_};
 
     for (int row = 1; row < rows; row++) {
       for (int column = 1; column < columns; column++) {
@@ -29,6 +34,7 @@ public:
 
         if (maxBlockDistance == 10) {
           board.MakeBlock(cell);
+          criticalPathFinder.BlockAdded(cell);
           continue;
         }
 
@@ -43,6 +49,7 @@ public:
         for (int i = 2; i < maxBlockDistance; i++) {
           if (blockDistribution_(random_)) {
             board.MakeBlock(cell);
+            criticalPathFinder.BlockAdded(cell);
             break;
           }
         }
@@ -61,42 +68,55 @@ public:
   }
 
 private:
-  void FillThinNeighbors(Board& board, const Cell& cell) {
-    if (cell.isBlock) {
-      return;
-    }
+  // Makes blocks of cells that are locked in by blocks, and then of their neighbors that got locked
+  // in by that in turn. Uses an explicit worklist instead of recursion, so that long chains of
+  // locked in cells can't overflow the stack. Cells only ever get more locked in as blocks are
+  // added, so the order in which we check them doesn't matter.
+  void FillThinNeighbors(Board& board, const Cell& startCell) {
+    worklist_.clear();
+    worklist_.push_back(&startCell);
+    while (!worklist_.empty()) {
+      const Cell& cell = *worklist_.back();
+      worklist_.pop_back();
+      if (cell.isBlock) {
+        continue;
+      }
 
-    int rowBlockDistance = cell.RowBlockDistance();
-    int columnBlockDistance = cell.ColumnBlockDistance();
+      int rowBlockDistance = cell.RowBlockDistance();
+      int columnBlockDistance = cell.ColumnBlockDistance();
 
-    bool isNextRowFree = false;
-    if (cell.row + 1 < board.Rows() && !board(cell.row + 1, cell.column).isBlock) {
-      isNextRowFree = true;
-    }
+      bool isNextRowFree = false;
+      if (cell.row + 1 < board.Rows() && !board(cell.row + 1, cell.column).isBlock) {
+        isNextRowFree = true;
+      }
 
-    bool isNextColumnFree = false;
-    if (cell.column + 1 < board.Columns() && !board(cell.row, cell.column + 1).isBlock) {
-      isNextColumnFree = true;
-    }
+      bool isNextColumnFree = false;
+      if (cell.column + 1 < board.Columns() && !board(cell.row, cell.column + 1).isBlock) {
+        isNextColumnFree = true;
+      }
 
-    bool isLockedInRows = columnBlockDistance == 1 && !isNextRowFree;
-    bool isLockedInColumns = rowBlockDistance == 1 && !isNextColumnFree;
-    if (isLockedInRows || isLockedInColumns) {
-      board.MakeBlock(cell);
-      FillThinNeighbors(board, board(cell.row - 1, cell.column));
-      FillThinNeighbors(board, board(cell.row, cell.column - 1));
+      bool isLockedInRows = columnBlockDistance == 1 && !isNextRowFree;
+      bool isLockedInColumns = rowBlockDistance == 1 && !isNextColumnFree;
+      if (isLockedInRows || isLockedInColumns) {
+        board.MakeBlock(cell);
 
-      if (cell.row + 1 < board.Rows()) {
-        FillThinNeighbors(board, board(cell.row + 1, cell.column));
-      }
-      if (cell.column + 1 < board.Columns()) {
-        FillThinNeighbors(board, board(cell.row, cell.column + 1));
+        // Pushed in reverse so that we visit them in the same order as the recursive version did.
+        if (cell.column + 1 < board.Columns()) {
+          worklist_.push_back(&board(cell.row, cell.column + 1));
+        }
+        if (cell.row + 1 < board.Rows()) {
+          worklist_.push_back(&board(cell.row + 1, cell.column));
+        }
+        worklist_.push_back(&board(cell.row, cell.column - 1));
+        worklist_.push_back(&board(cell.row - 1, cell.column));
       }
     }
   }
 
   std::mt19937& random_;
   std::bernoulli_distribution blockDistribution_;
+  CriticalPathMode criticalPathMode_;
+  std::vector<const Cell*> worklist_;
 };
 
 } // namespace kakuro
@@ -0,0 +1,196 @@
+#ifndef BOARD_RENDERER_H
+#define BOARD_RENDERER_H
+
+#include "board.h"
+#include <charconv>
+#include <ostream>
+#include <string>
+
+namespace kakuro {
+
+enum class RenderFormat {
+  kHtml, // a table, where free cells can contain any markup such as input fields
+  kSvg, // a standalone image for printing, where free cells can only contain text
+};
+
+// Renders boards into a single buffer, which is reused between boards so that rendering many of
+// them allocates next to nothing. Nothing is written until WriteTo, which writes the whole buffer
+// at once. Free cells are rendered by a cell printer that appends to the buffer, and which is a
+// template argument so that it can be inlined into the loop over the cells.
+class BoardRenderer {
+public:
+  BoardRenderer(RenderFormat format = RenderFormat::kHtml) : format_{format} {}
+
+  // Renders a board as a complete document, with free cells showing their number if they are
+  // filled.
+  void Render(const Board& board) {
+    Render(board, [](std::string& output, const Cell& cell) {
+      if (cell.number > 0) {
+        AppendInteger(output, cell.number);
+      }
+    });
+  }
+
+  // Renders a board as a complete document, with free cells printed by calling
+  // cellPrinter(std::string& output, const Cell& cell).
+  template <typename CellPrinter>
+  void Render(const Board& board, CellPrinter&& cellPrinter) {
+    int numCells = board.Rows() * board.Columns();
+    if (format_ == RenderFormat::kHtml) {
+      buffer_.reserve(buffer_.size() + 1024 + kHtmlBytesPerCell * numCells);
+      RenderHtml(board, cellPrinter);
+    } else {
+      buffer_.reserve(buffer_.size() + 1024 + kSvgBytesPerCell * numCells);
+      RenderSvg(board, cellPrinter);
+    }
+  }
+
+  const std::string& Buffer() const { return buffer_; }
+
+  // Writes everything rendered since the last call to the output, and clears the buffer while
+  // keeping its memory. Returns whether writing succeeded.
+  bool WriteTo(std::ostream& output) {
+    output.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    return static_cast<bool>(output);
+  }
+
+  static void AppendInteger(std::string& output, int value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    output.append(digits, result.ptr);
+  }
+
+private:
+  static constexpr int kHtmlBytesPerCell = 48;
+  static constexpr int kSvgBytesPerCell = 96;
+  static constexpr int kCellSize = 48;
+
+  template <typename CellPrinter>
+  void RenderHtml(const Board& board, CellPrinter& cellPrinter) {
+    buffer_ +=
+        "<!doctype html>\n"
+        "<html>\n"
+        "<head>\n"
+        "<meta charset=\"utf-8\">\n"
+        "<title>Kakuro</title>\n"
+        "<style type=\"text/css\">\n"
+        "table { border-collapse: collapse }\n"
+        "td { width: 48px; height: 48px; padding: 0; border: 1px solid black; text-align: center; "
+        "vertical-align: middle; color: black }\n"
+        "td.b { position: relative; background-color: black; color: white }\n"
+        "td.b span { position: absolute }\n"
+        "span.r { top: 4px; right: 4px }\n"
+        "span.c { bottom: 4px; left: 4px }\n"
+        "input { border: 0px; background: transparent; text-align: center; width: 100%; }\n"
+        "</style>\n"
+        "</head>\n"
+        "<body>\n"
+        "<table>\n";
+
+    for (int row = 0; row < board.Rows(); row++) {
+      buffer_ += "<tr>";
+      for (int column = 0; column < board.Columns(); column++) {
+        const Cell& cell = board(row, column);
+        if (cell.isBlock) {
+          buffer_ += "<td class=\"b\">";
+          if (cell.rowBlockSum > 0) {
+            buffer_ += "<span class=\"r\">";
+            AppendInteger(buffer_, cell.rowBlockSum);
+            buffer_ += "</span>";
+          }
+          if (cell.columnBlockSum > 0) {
+            buffer_ += "<span class=\"c\">";
+            AppendInteger(buffer_, cell.columnBlockSum);
+            buffer_ += "</span>";
+          }
+        } else {
+          buffer_ += "<td>";
+          cellPrinter(buffer_, cell);
+        }
+        buffer_ += "</td>";
+      }
+      buffer_ += "</tr>\n";
+    }
+
+    buffer_ +=
+        "</table>\n"
+        "</body>\n"
+        "</html>\n";
+  }
+
+  template <typename CellPrinter>
+  void RenderSvg(const Board& board, CellPrinter& cellPrinter) {
+    int width = board.Columns() * kCellSize + 2;
+    int height = board.Rows() * kCellSize + 2;
+    buffer_ += "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"";
+    AppendInteger(buffer_, width);
+    buffer_ += "\" height=\"";
+    AppendInteger(buffer_, height);
+    buffer_ +=
+        "\">\n"
+        "<style>\n"
+        "rect { fill: white; stroke: black }\n"
+        "rect.b { fill: black }\n"
+        "text { font: 20px sans-serif; text-anchor: middle; dominant-baseline: central }\n"
+        "text.s { font-size: 13px; fill: white }\n"
+        "</style>\n";
+
+    for (int row = 0; row < board.Rows(); row++) {
+      for (int column = 0; column < board.Columns(); column++) {
+        const Cell& cell = board(row, column);
+        int x = column * kCellSize + 1;
+        int y = row * kCellSize + 1;
+        if (cell.isBlock) {
+          AppendRect(x, y, " class=\"b\"");
+          if (cell.rowBlockSum > 0) {
+            AppendText(x + 3 * kCellSize / 4, y + kCellSize / 4, " class=\"s\"");
+            AppendInteger(buffer_, cell.rowBlockSum);
+            buffer_ += "</text>";
+          }
+          if (cell.columnBlockSum > 0) {
+            AppendText(x + kCellSize / 4, y + 3 * kCellSize / 4, " class=\"s\"");
+            AppendInteger(buffer_, cell.columnBlockSum);
+            buffer_ += "</text>";
+          }
+        } else {
+          AppendRect(x, y, "");
+          AppendText(x + kCellSize / 2, y + kCellSize / 2, "");
+          cellPrinter(buffer_, cell);
+          buffer_ += "</text>";
+        }
+        buffer_ += "\n";
+      }
+    }
+
+    buffer_ += "</svg>\n";
+  }
+
+  void AppendRect(int x, int y, const char* attributes) {
+    buffer_ += "<rect x=\"";
+    AppendInteger(buffer_, x);
+    buffer_ += "\" y=\"";
+    AppendInteger(buffer_, y);
+    buffer_ += "\" width=\"48\" height=\"48\"";
+    buffer_ += attributes;
+    buffer_ += "/>";
+  }
+
+  // Opens a text element, which the caller fills and closes.
+  void AppendText(int x, int y, const char* attributes) {
+    buffer_ += "<text x=\"";
+    AppendInteger(buffer_, x);
+    buffer_ += "\" y=\"";
+    AppendInteger(buffer_, y);
+    buffer_ += "\"";
+    buffer_ += attributes;
+    buffer_ += ">";
+  }
+
+  RenderFormat format_;
+  std::string buffer_;
+};
+
+} // namespace kakuro
+
+#endif
@@ -0,0 +1,67 @@
+#include "board_renderer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+using namespace kakuro;
+
+namespace {
+Board MakeBoard() {
+  Board board{3, 3};
+  board.MakeBlock(board(1, 2));
+  board.SetBlockSum(board(0, 1), /* isRow */ false, 17);
+  board.SetBlockSum(board(2, 0), /* isRow */ true, 12);
+  board.SetNumber(board(2, 1), 8);
+  return board;
+}
+
+int CountOccurrences(const std::string& text, const std::string& pattern) {
+  int count = 0;
+  for (auto i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) {
+    count++;
+  }
+  return count;
+}
+} // namespace
+
+TEST(BoardRendererTest, RenderHtml) {
+  Board board = MakeBoard();
+  BoardRenderer renderer;
+  renderer.Render(board);
+  const std::string& html = renderer.Buffer();
+  ASSERT_EQ(CountOccurrences(html, "<tr>"), 3);
+  ASSERT_EQ(CountOccurrences(html, "<td class=\"b\">"), 6);
+  ASSERT_EQ(CountOccurrences(html, "<td>"), 3);
+  ASSERT_THAT(html, testing::HasSubstr("<td class=\"b\"><span class=\"c\">17</span></td>"));
+  ASSERT_THAT(
+      html, testing::HasSubstr("<td class=\"b\"><span class=\"r\">12</span></td><td>8</td>"));
+  ASSERT_THAT(html, testing::EndsWith("</html>\n"));
+
+  std::ostringstream output;
+  ASSERT_TRUE(renderer.WriteTo(output));
+  ASSERT_EQ(output.str().size(), output.str().find("</html>\n") + 8);
+  ASSERT_TRUE(renderer.Buffer().empty());
+}
+
+TEST(BoardRendererTest, RenderSvg) {
+  Board board = MakeBoard();
+  BoardRenderer renderer{RenderFormat::kSvg};
+  renderer.Render(board, [](std::string& output, const Cell& cell) {
+    output += cell.number > 0 ? "x" : "";
+  });
+  const std::string& svg = renderer.Buffer();
+  ASSERT_THAT(svg, testing::StartsWith("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"146\""));
+  ASSERT_EQ(CountOccurrences(svg, "<rect "), 9);
+  ASSERT_EQ(CountOccurrences(svg, "class=\"b\""), 6);
+  ASSERT_THAT(svg, testing::HasSubstr("<text x=\"61\" y=\"37\" class=\"s\">17</text>"));
+  ASSERT_THAT(svg, testing::HasSubstr("<text x=\"37\" y=\"109\" class=\"s\">12</text>"));
+  ASSERT_THAT(svg, testing::HasSubstr("<text x=\"73\" y=\"121\">x</text>"));
+  ASSERT_THAT(svg, testing::EndsWith("</svg>\n"));
+
+  // Boards rendered before writing end up in the same output.
+  renderer.Render(board);
+  ASSERT_EQ(CountOccurrences(renderer.Buffer(), "<svg "), 2);
+}
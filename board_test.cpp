@@ -0,0 +1,91 @@
+#include "board.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+using namespace kakuro;
+
+TEST(BoardTest, FromBlockMask) {
+  std::mt19937 random;
+  random.seed(7);
+  std::bernoulli_distribution blockDistribution{0.3};
+  std::uniform_int_distribution<int> numberDistribution{0, 9};
+  std::uniform_int_distribution<int> sumDistribution{0, 45};
+
+  for (int attempt = 0; attempt < 20; attempt++) {
+    int rows = 2 + attempt % 7;
+    int columns = 2 + attempt % 5;
+    int numCells = rows * columns;
+    std::vector<bool> isBlock(numCells);
+    std::vector<uint8_t> columnBlockSums(numCells);
+    std::vector<uint8_t> rowBlockSums(numCells);
+    std::vector<uint8_t> numbers(numCells);
+    for (int i = 0; i < numCells; i++) {
+      isBlock[i] = i < columns || i % columns == 0 || blockDistribution(random);
+      if (isBlock[i]) {
+        columnBlockSums[i] = sumDistribution(random);
+        rowBlockSums[i] = sumDistribution(random);
+      } else {
+        numbers[i] = numberDistribution(random);
+      }
+    }
+
+    // Build the same board one block at a time.
+    Board expected{rows, columns};
+    for (int i = 0; i < numCells; i++) {
+      if (isBlock[i] && !expected[i].isBlock) {
+        expected.MakeBlock(expected[i]);
+      }
+    }
+    for (int i = 0; i < numCells; i++) {
+      if (isBlock[i]) {
+        expected.SetBlockSum(expected[i], /* isRow */ true, rowBlockSums[i]);
+        expected.SetBlockSum(expected[i], /* isRow */ false, columnBlockSums[i]);
+      } else {
+        expected.SetNumber(expected[i], numbers[i]);
+      }
+    }
+
+    Board board =
+        Board::FromBlockMask(rows, columns, isBlock, columnBlockSums, rowBlockSums, numbers);
+    ASSERT_EQ(board.Numbers(), expected.Numbers());
+    for (int i = 0; i < numCells; i++) {
+      const Cell& cell = board[i];
+      const Cell& expectedCell = expected[i];
+      ASSERT_EQ(cell.row, expectedCell.row);
+      ASSERT_EQ(cell.column, expectedCell.column);
+      ASSERT_EQ(cell.isBlock, expectedCell.isBlock);
+      ASSERT_EQ(cell.number, expectedCell.number);
+      ASSERT_EQ(board.Index(board.RowBlock(cell)), expected.Index(expected.RowBlock(expectedCell)));
+      ASSERT_EQ(
+          board.Index(board.ColumnBlock(cell)),
+          expected.Index(expected.ColumnBlock(expectedCell)));
+      if (cell.isBlock) {
+        ASSERT_EQ(cell.rowBlockSize, expectedCell.rowBlockSize);
+        ASSERT_EQ(cell.rowBlockFree, expectedCell.rowBlockFree);
+        ASSERT_EQ(cell.rowBlockSum, expectedCell.rowBlockSum);
+        ASSERT_EQ(cell.columnBlockSize, expectedCell.columnBlockSize);
+        ASSERT_EQ(cell.columnBlockFree, expectedCell.columnBlockFree);
+        ASSERT_EQ(cell.columnBlockSum, expectedCell.columnBlockSum);
+      } else {
+        ASSERT_EQ(cell.RowBlockDistance(), expectedCell.RowBlockDistance());
+        ASSERT_EQ(cell.ColumnBlockDistance(), expectedCell.ColumnBlockDistance());
+      }
+    }
+  }
+}
+
+TEST(BoardTest, FromBlockMaskWithoutSums) {
+  std::vector<bool> isBlock{true, true, true, true, false, true, true, false, false};
+  Board board = Board::FromBlockMask(3, 3, isBlock);
+  ASSERT_EQ(board.Numbers(), 3);
+  ASSERT_EQ(board(0, 1).columnBlockSize, 2);
+  ASSERT_EQ(board(0, 2).columnBlockSize, 0);
+  ASSERT_EQ(board(1, 2).columnBlockSize, 1);
+  ASSERT_EQ(board(1, 0).rowBlockSize, 1);
+  ASSERT_EQ(board(1, 2).rowBlockSize, 0);
+  ASSERT_EQ(board(2, 0).rowBlockSize, 2);
+  ASSERT_EQ(board(2, 0).rowBlockFree, 2);
+  ASSERT_EQ(board(2, 0).rowBlockSum, 0);
+}
@@ -0,0 +1,69 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace kakuro {
+
+// A queue between pipeline stages that blocks producers while it is full, so that a fast stage
+// can't run arbitrarily far ahead of a slow one. Once all producers are done, Close makes consumers
+// drain the remaining items and then stop.
+template <typename T>
+class BoundedQueue {
+public:
+  BoundedQueue(std::size_t capacity) : capacity_{capacity}, closed_{false} {
+    assert(capacity > 0);
+  }
+
+  // Returns false without pushing if the queue was closed.
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  // Returns nothing once the queue is closed and empty.
+  std::optional<T> Pop() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    T item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    notFull_.notify_one();
+    return item;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      closed_ = true;
+    }
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+  }
+
+private:
+  std::size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+  std::deque<T> items_;
+  bool closed_;
+};
+
+} // namespace kakuro
+
+#endif
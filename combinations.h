@@ -3,69 +3,107 @@
 
 #include "numbers.h"
 #include <array>
-#include <vector>
+#include <cassert>
+#include <cstdint>
 
 namespace kakuro {
 
+// All subsets of the numbers 1-9 grouped by their sum and size, generated at compile time. The
+// subsets of each group are stored contiguously in one flat array that the groups index into.
 class Combinations {
 public:
   struct CombinationsPerSizePerSum {
-    std::vector<Numbers> numberCombinations;
+    uint16_t offset;
+    uint16_t numCombinations;
     Numbers possibleNumbers;
     Numbers necessaryNumbers;
+
+    constexpr bool Empty() const { return numCombinations == 0; }
   };
 
-  Combinations() {
-    Numbers numbers;
-    AddNumber(numbers, 1);
+  // A view of the combinations of a single group.
+  class NumberCombinations {
+  public:
+    constexpr NumberCombinations(const Numbers* begin, const Numbers* end)
+        : begin_{begin}, end_{end} {}
 
-    for (int sum = 1; sum <= 45; sum++) {
-      for (int size = 1; size <= 9; size++) {
-        const auto& possibleCombinations = combinations[sum][size].numberCombinations;
-        if (possibleCombinations.empty()) {
-          continue;
-        }
+    constexpr const Numbers* begin() const { return begin_; }
+    constexpr const Numbers* end() const { return end_; }
+    constexpr int size() const { return static_cast<int>(end_ - begin_); }
+    constexpr bool empty() const { return begin_ == end_; }
+    constexpr const Numbers& operator[](int index) const { return begin_[index]; }
+
+  private:
+    const Numbers* begin_;
+    const Numbers* end_;
+  };
+
+  constexpr Combinations() : combinations{}, groups{} {
+    // Counting sort of all subsets by sum and size.
+    for (int bits = 0; bits < 512; bits++) {
+      groups[kNumbersTables.sum[bits]][kNumbersTables.count[bits]].numCombinations++;
+    }
+
+    int offset = 0;
+    for (auto& perSize : groups) {
+      for (auto& group : perSize) {
+        group.offset = static_cast<uint16_t>(offset);
+        offset += group.numCombinations;
+        group.numCombinations = 0;
+        group.necessaryNumbers.Fill();
+      }
+    }
+
+    for (int bits = 0; bits < 512; bits++) {
+      auto numbers = Numbers::FromBits(static_cast<uint16_t>(bits));
+      auto& group = groups[numbers.Sum()][numbers.Count()];
+      combinations[group.offset + group.numCombinations++] = numbers;
+      group.possibleNumbers.Or(numbers);
+      group.necessaryNumbers.And(numbers);
+    }
 
-        Numbers& possibleNumbers = combinations[sum][size].possibleNumbers;
-        Numbers& necessaryNumbers = combinations[sum][size].necessaryNumbers;
-        possibleNumbers = Numbers{};
-        necessaryNumbers.Fill();
-        for (auto combination : possibleCombinations) {
-          possibleNumbers.Or(combination);
-          necessaryNumbers.And(combination);
+    for (auto& perSize : groups) {
+      for (auto& group : perSize) {
+        if (group.Empty()) {
+          group.necessaryNumbers.Clear();
         }
       }
     }
   }
 
-  const CombinationsPerSizePerSum& PerSizePerSum(int sum, int size) const {
+  constexpr const CombinationsPerSizePerSum& PerSizePerSum(int sum, int size) const {
     assert(sum >= 0);
     assert(sum < 46);
     assert(size > 0);
     assert(size <= 9);
-    return combinations[sum][size];
+    return groups[sum][size];
   }
 
-private:
-  void AddNumber(Numbers numbers, int number) {
-    int count = numbers.Count();
-    int sum = numbers.Sum();
-    if (number > 9) {
-      combinations[sum][count].numberCombinations.push_back(numbers);
-    }
-
-    if (number <= 9) {
-      AddNumber(numbers, number + 1);
-
-      numbers.Add(number);
-      AddNumber(numbers, number + 1);
+  // The largest number of combinations of any sum and size.
+  constexpr int MaxNumCombinations() const {
+    int maxNumCombinations = 0;
+    for (const auto& perSize : groups) {
+      for (const auto& group : perSize) {
+        if (group.numCombinations > maxNumCombinations) {
+          maxNumCombinations = group.numCombinations;
+        }
+      }
     }
+    return maxNumCombinations;
   }
 
+  constexpr NumberCombinations Of(const CombinationsPerSizePerSum& group) const {
+    const Numbers* begin = combinations.data() + group.offset;
+    return NumberCombinations{begin, begin + group.numCombinations};
+  }
 
-  std::array<std::array<CombinationsPerSizePerSum, 10>, 46> combinations;
+private:
+  std::array<Numbers, 512> combinations;
+  std::array<std::array<CombinationsPerSizePerSum, 10>, 46> groups;
 };
 
+inline constexpr Combinations kCombinations{};
+
 } // namespace kakuro
 
 #endif
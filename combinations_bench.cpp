@@ -0,0 +1,44 @@
+#include "combinations.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace kakuro;
+
+namespace {
+
+// Looks up the group of every sum and size, like propagation does for each block it visits.
+void BM_CombinationsPerSizePerSum(benchmark::State& state) {
+  for (auto _ : state) {
+    Numbers possibleNumbers;
+    int numCombinations = 0;
+    for (int sum = 0; sum < 46; sum++) {
+      for (int size = 1; size <= 9; size++) {
+        const auto& group = kCombinations.PerSizePerSum(sum, size);
+        possibleNumbers.Or(group.possibleNumbers);
+        numCombinations += group.numCombinations;
+      }
+    }
+    benchmark::DoNotOptimize(possibleNumbers);
+    benchmark::DoNotOptimize(numCombinations);
+  }
+}
+BENCHMARK(BM_CombinationsPerSizePerSum);
+
+// Visits all combinations of every group, like combination propagation does for blocks whose
+// remaining combinations it filters.
+void BM_CombinationsIterate(benchmark::State& state) {
+  for (auto _ : state) {
+    Numbers possibleNumbers;
+    for (int sum = 0; sum < 46; sum++) {
+      for (int size = 1; size <= 9; size++) {
+        for (const Numbers& numbers : kCombinations.Of(kCombinations.PerSizePerSum(sum, size))) {
+          possibleNumbers.Or(numbers);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(possibleNumbers);
+  }
+}
+BENCHMARK(BM_CombinationsIterate);
+
+} // namespace
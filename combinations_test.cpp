@@ -0,0 +1,68 @@
+#include "combinations.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace kakuro;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace {
+Numbers MakeNumbers(std::initializer_list<int> numbers) {
+  Numbers result;
+  for (int number : numbers) {
+    result.Add(number);
+  }
+  return result;
+}
+
+std::vector<uint16_t> CombinationBits(int sum, int size) {
+  std::vector<uint16_t> bits;
+  for (const Numbers& combination : kCombinations.Of(kCombinations.PerSizePerSum(sum, size))) {
+    bits.push_back(combination.Bits());
+  }
+  return bits;
+}
+} // namespace
+
+static_assert(kCombinations.PerSizePerSum(45, 9).numCombinations == 1);
+static_assert(kCombinations.PerSizePerSum(45, 8).Empty());
+
+TEST(CombinationsTest, UniqueCombination) {
+  const auto& group = kCombinations.PerSizePerSum(7, 3);
+  ASSERT_THAT(CombinationBits(7, 3), ElementsAre(MakeNumbers({1, 2, 4}).Bits()));
+  ASSERT_EQ(group.possibleNumbers, MakeNumbers({1, 2, 4}));
+  ASSERT_EQ(group.necessaryNumbers, MakeNumbers({1, 2, 4}));
+}
+
+TEST(CombinationsTest, MultipleCombinations) {
+  const auto& group = kCombinations.PerSizePerSum(10, 3);
+  ASSERT_EQ(group.numCombinations, 4); // 1+2+7, 1+3+6, 1+4+5, 2+3+5
+  ASSERT_EQ(group.possibleNumbers, MakeNumbers({1, 2, 3, 4, 5, 6, 7}));
+  ASSERT_EQ(group.necessaryNumbers, Numbers{});
+  for (const Numbers& combination : kCombinations.Of(group)) {
+    ASSERT_EQ(combination.Sum(), 10);
+    ASSERT_EQ(combination.Count(), 3);
+  }
+}
+
+TEST(CombinationsTest, ImpossibleSum) {
+  const auto& group = kCombinations.PerSizePerSum(2, 2);
+  ASSERT_TRUE(group.Empty());
+  ASSERT_THAT(CombinationBits(2, 2), IsEmpty());
+  ASSERT_EQ(group.possibleNumbers, Numbers{});
+  ASSERT_EQ(group.necessaryNumbers, Numbers{});
+}
+
+TEST(CombinationsTest, CoversAllSubsets) {
+  int numCombinations = 0;
+  for (int sum = 0; sum < 46; sum++) {
+    for (int size = 1; size <= 9; size++) {
+      numCombinations += kCombinations.PerSizePerSum(sum, size).numCombinations;
+    }
+  }
+  // Every non-empty subset of 1-9 exactly once.
+  ASSERT_EQ(numCombinations, 511);
+}
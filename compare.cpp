@@ -0,0 +1,353 @@
+#include "board.h"
+#include "board_generator.h"
+#include "constrained_board.h"
+#include "legacy_engine.h"
+#include "logger.h"
+#include "solver.h"
+#include "sum_generator.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace kakuro;
+
+namespace {
+
+// How a set of sums fared when solving the puzzle they describe.
+enum class SumsStatus { kSolved, kNoSolution, kBudgetExceeded, kIncomplete };
+
+const char* SumsStatusName(SumsStatus status) {
+  switch (status) {
+    case SumsStatus::kSolved:
+      return "solved";
+    case SumsStatus::kNoSolution:
+      return "noSolution";
+    case SumsStatus::kBudgetExceeded:
+      return "budgetExceeded";
+    case SumsStatus::kIncomplete:
+      return "incomplete";
+  }
+  return "";
+}
+
+struct EngineResult {
+  double milliseconds = 0.0;
+  int numSums = 0;
+  bool validSolution = false; // only for kakuro2, which fills in the numbers it chose sums for
+  SumsStatus status = SumsStatus::kIncomplete;
+};
+
+struct Comparison {
+  uint32_t seed;
+  int numBlockSums; // row and column blocks of the layout
+  int numIdenticalSums;
+  EngineResult legacy;
+  EngineResult kakuro2;
+};
+
+struct EngineTotals {
+  double milliseconds = 0.0;
+  int numValid = 0;
+  int numSolved = 0;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Builds the legacy board for a layout, placing its blocks in the same order as the generator.
+void CopyLayout(const Board& layout, legacy::Board& legacyBoard) {
+  for (int row = 1; row < layout.Rows(); row++) {
+    for (int column = 1; column < layout.Columns(); column++) {
+      if (layout(row, column).isBlock) {
+        legacyBoard.MakeBlock(legacyBoard.CellAt(row, column));
+      }
+    }
+  }
+}
+
+// Builds a puzzle with the layout's blocks and the legacy engine's sums.
+Board PuzzleFromLegacy(const Board& layout, legacy::Board& legacyBoard) {
+  int numCells = layout.Rows() * layout.Columns();
+  std::vector<bool> isBlock(numCells);
+  std::vector<uint8_t> columnBlockSums(numCells);
+  std::vector<uint8_t> rowBlockSums(numCells);
+  for (int i = 0; i < numCells; i++) {
+    auto& legacyCell = legacyBoard.CellAt(i / layout.Columns(), i % layout.Columns());
+    isBlock[i] = layout[i].isBlock;
+    if (isBlock[i]) {
+      columnBlockSums[i] = legacyCell.sumColumn;
+      rowBlockSums[i] = legacyCell.sumRow;
+    }
+  }
+  return Board::FromBlockMask(
+      layout.Rows(), layout.Columns(), isBlock, columnBlockSums, rowBlockSums);
+}
+
+// Builds a puzzle with the blocks and sums of a board, but without its numbers.
+Board PuzzleFromSums(const Board& board) {
+  int numCells = board.Rows() * board.Columns();
+  std::vector<bool> isBlock(numCells);
+  std::vector<uint8_t> columnBlockSums(numCells);
+  std::vector<uint8_t> rowBlockSums(numCells);
+  for (int i = 0; i < numCells; i++) {
+    isBlock[i] = board[i].isBlock;
+    columnBlockSums[i] = board[i].columnBlockSum;
+    rowBlockSums[i] = board[i].rowBlockSum;
+  }
+  return Board::FromBlockMask(
+      board.Rows(), board.Columns(), isBlock, columnBlockSums, rowBlockSums);
+}
+
+int CountSums(const Board& board) {
+  int numSums = 0;
+  int numCells = board.Rows() * board.Columns();
+  for (int i = 0; i < numCells; i++) {
+    numSums += (board[i].IsRowBlock() && board[i].rowBlockSum > 0) +
+        (board[i].IsColumnBlock() && board[i].columnBlockSum > 0);
+  }
+  return numSums;
+}
+
+// Checks that every block has a sum, and that its cells are filled with distinct numbers adding up
+// to it.
+bool IsValidSolution(const Board& board) {
+  int numCells = board.Rows() * board.Columns();
+  for (int i = 0; i < numCells; i++) {
+    const Cell& cell = board[i];
+    for (bool isRow : {true, false}) {
+      if (!cell.isBlock || cell.BlockSize(isRow) == 0) {
+        continue;
+      }
+      bool valid = true;
+      int sum = 0;
+      std::array<bool, 10> used{};
+      board.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
+        if (currentCell.number < 1 || used[currentCell.number]) {
+          valid = false;
+          return;
+        }
+        used[currentCell.number] = true;
+        sum += currentCell.number;
+      });
+      if (!valid || sum != cell.BlockSum(isRow)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+SumsStatus SolveSums(Board& puzzle, int numBlockSums, long long maxNodes) {
+  if (CountSums(puzzle) < numBlockSums) {
+    return SumsStatus::kIncomplete;
+  }
+  ConstrainedBoard constrainedBoard{puzzle};
+  Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+  SolveBudget budget;
+  budget.maxNodes = maxNodes;
+  SolveContinuation continuation;
+  switch (solver.Solve(constrainedBoard, budget, continuation)) {
+    case SolveStatus::kSolved:
+      return SumsStatus::kSolved;
+    case SolveStatus::kNoSolution:
+      return SumsStatus::kNoSolution;
+    case SolveStatus::kBudgetExceeded:
+      return SumsStatus::kBudgetExceeded;
+  }
+  return SumsStatus::kIncomplete;
+}
+
+void WriteEngineJson(std::ostream& output, const EngineResult& result, bool withValidity) {
+  output << "{\"milliseconds\": " << result.milliseconds << ", \"sums\": " << result.numSums;
+  if (withValidity) {
+    output << ", \"validSolution\": " << (result.validSolution ? "true" : "false");
+  }
+  output << ", \"status\": \"" << SumsStatusName(result.status) << "\"}";
+}
+
+void WriteTotalsJson(
+    std::ostream& output, const EngineTotals& totals, int numPuzzles, bool withValidity) {
+  double seconds = totals.milliseconds / 1000.0;
+  output << "{\"milliseconds\": " << totals.milliseconds
+         << ", \"puzzlesPerSecond\": " << (seconds > 0.0 ? numPuzzles / seconds : 0.0);
+  if (withValidity) {
+    output << ", \"validSolutions\": " << totals.numValid;
+  }
+  output << ", \"solved\": " << totals.numSolved << "}";
+}
+
+void WriteReport(
+    std::ostream& output,
+    int rows,
+    int columns,
+    double blockProbability,
+    const std::vector<Comparison>& comparisons) {
+  EngineTotals legacyTotals;
+  EngineTotals kakuro2Totals;
+  int numIdenticalSums = 0;
+  int numBlockSums = 0;
+  for (const auto& comparison : comparisons) {
+    legacyTotals.milliseconds += comparison.legacy.milliseconds;
+    legacyTotals.numSolved += comparison.legacy.status == SumsStatus::kSolved;
+    kakuro2Totals.milliseconds += comparison.kakuro2.milliseconds;
+    kakuro2Totals.numValid += comparison.kakuro2.validSolution;
+    kakuro2Totals.numSolved += comparison.kakuro2.status == SumsStatus::kSolved;
+    numIdenticalSums += comparison.numIdenticalSums;
+    numBlockSums += comparison.numBlockSums;
+  }
+
+  int numPuzzles = comparisons.size();
+  output << "{\n";
+  output << "  \"rows\": " << rows << ",\n";
+  output << "  \"columns\": " << columns << ",\n";
+  output << "  \"blockProbability\": " << blockProbability << ",\n";
+  output << "  \"summary\": {\n";
+  output << "    \"puzzles\": " << numPuzzles << ",\n";
+  output << "    \"blockSums\": " << numBlockSums << ",\n";
+  output << "    \"identicalSums\": " << numIdenticalSums << ",\n";
+  output << "    \"legacy\": ";
+  WriteTotalsJson(output, legacyTotals, numPuzzles, /* withValidity */ false);
+  output << ",\n";
+  output << "    \"kakuro2\": ";
+  WriteTotalsJson(output, kakuro2Totals, numPuzzles, /* withValidity */ true);
+  output << "\n";
+  output << "  },\n";
+  output << "  \"puzzles\": [";
+  for (std::size_t i = 0; i < comparisons.size(); i++) {
+    const auto& comparison = comparisons[i];
+    output << (i > 0 ? ",\n" : "\n");
+    output << "    {\"seed\": " << comparison.seed << ", \"blockSums\": " << comparison.numBlockSums
+           << ", \"identicalSums\": " << comparison.numIdenticalSums << ", \"legacy\": ";
+    WriteEngineJson(output, comparison.legacy, /* withValidity */ false);
+    output << ", \"kakuro2\": ";
+    WriteEngineJson(output, comparison.kakuro2, /* withValidity */ true);
+    output << "}";
+  }
+  output << "\n  ]\n";
+  output << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 7 && argc != 8) {
+    std::cout << "Usage: kakuro_compare [first seed] [last seed] [rows] [columns] "
+                 "[block probability] [report file] [max solver nodes]"
+              << std::endl;
+    std::cout << "Example: kakuro_compare 0 19 10 10 0.3 compare.json" << std::endl;
+    std::cout << "Generates a layout per seed, then generates sums for it with both the legacy "
+                 "engine and kakuro2, and writes a JSON report comparing their time, the "
+                 "validity of their sums and the sums themselves."
+              << std::endl;
+    std::cout << "Sums are checked by solving them, giving up after the given number of solver "
+                 "nodes (100000 by default). The legacy engine gets the same budget for the "
+                 "solving it does while generating sums."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  uint32_t firstSeed = std::strtoul(argv[1], nullptr, 10);
+  uint32_t lastSeed = std::strtoul(argv[2], nullptr, 10);
+  int rows = std::atoi(argv[3]);
+  int columns = std::atoi(argv[4]);
+  double blockProbability = std::atof(argv[5]);
+  std::string reportFilename{argv[6]};
+  long long maxNodes = argc > 7 ? std::atoll(argv[7]) : 100000;
+
+  Logger logger;
+  if (firstSeed > lastSeed || rows < 2 || columns < 2 || maxNodes < 1) {
+    logger.Log(LogLevel::kError) << "Invalid comparison options";
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream reportFile{reportFilename};
+  if (!reportFile) {
+    logger.Log(LogLevel::kError) << "Failed to open report file";
+    return EXIT_FAILURE;
+  }
+
+  auto combinations = legacy::GenerateCombinations();
+  std::ostream nullLog{nullptr};
+
+  std::vector<Comparison> comparisons;
+  for (uint32_t seed = firstSeed;; seed++) {
+    std::mt19937 layoutRandom{seed};
+    BoardGenerator boardGenerator{layoutRandom, blockProbability};
+    auto layout = boardGenerator.Generate(rows, columns);
+
+    Comparison comparison;
+    comparison.seed = seed;
+    comparison.numBlockSums = 0;
+    int numCells = rows * columns;
+    for (int i = 0; i < numCells; i++) {
+      comparison.numBlockSums += layout[i].IsRowBlock() + layout[i].IsColumnBlock();
+    }
+
+    // Both engines get the same layout and a generator with the same seed.
+    legacy::Board legacyBoard{rows, columns};
+    legacyBoard.SetLog(nullLog);
+    legacyBoard.SetSolveBudget(maxNodes);
+    CopyLayout(layout, legacyBoard);
+    std::mt19937 legacyRandom{seed};
+    auto legacyStart = std::chrono::steady_clock::now();
+    legacy::GenerateSums(legacyBoard, combinations, legacyRandom, nullLog);
+    comparison.legacy.milliseconds = MillisecondsSince(legacyStart);
+
+    // The legacy engine only picks sums, so they are checked by solving them, unless it already
+    // gave up on checking them itself.
+    auto legacyPuzzle = PuzzleFromLegacy(layout, legacyBoard);
+    comparison.legacy.numSums = CountSums(legacyPuzzle);
+    comparison.legacy.status = legacyBoard.SolveBudgetExceeded()
+        ? SumsStatus::kBudgetExceeded
+        : SolveSums(legacyPuzzle, comparison.numBlockSums, maxNodes);
+
+    Board board{layout};
+    ConstrainedBoard constrainedBoard{board};
+    SumGenerator sumGenerator{/* verboseLogs */ false};
+    auto kakuro2Start = std::chrono::steady_clock::now();
+    bool generated = sumGenerator.GenerateSums(constrainedBoard);
+    comparison.kakuro2.milliseconds = MillisecondsSince(kakuro2Start);
+
+    // kakuro2 leaves the numbers it chose the sums for, which must solve the puzzle.
+    comparison.kakuro2.numSums = CountSums(board);
+    comparison.kakuro2.validSolution = generated && IsValidSolution(board);
+    auto kakuro2Puzzle = PuzzleFromSums(board);
+    comparison.kakuro2.status = SolveSums(kakuro2Puzzle, comparison.numBlockSums, maxNodes);
+
+    comparison.numIdenticalSums = 0;
+    for (int i = 0; i < numCells; i++) {
+      const Cell& legacyCell = legacyPuzzle[i];
+      const Cell& cell = board[i];
+      comparison.numIdenticalSums +=
+          (cell.IsRowBlock() && cell.rowBlockSum > 0 &&
+           cell.rowBlockSum == legacyCell.rowBlockSum) +
+          (cell.IsColumnBlock() && cell.columnBlockSum > 0 &&
+           cell.columnBlockSum == legacyCell.columnBlockSum);
+    }
+
+    logger.Log(LogLevel::kInfo) << "Seed " << seed << ": legacy "
+                                << SumsStatusName(comparison.legacy.status) << " in "
+                                << comparison.legacy.milliseconds << "ms, kakuro2 "
+                                << SumsStatusName(comparison.kakuro2.status) << " in "
+                                << comparison.kakuro2.milliseconds << "ms";
+    comparisons.push_back(comparison);
+
+    if (seed == lastSeed) {
+      break;
+    }
+  }
+
+  WriteReport(reportFile, rows, columns, blockProbability, comparisons);
+  if (!reportFile) {
+    logger.Log(LogLevel::kError) << "Failed to write report file";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -2,13 +2,19 @@
 #define CONSTRAINED_BOARD_H
 
 #include "board.h"
+#include "board_renderer.h"
 #include "combinations.h"
+#include "solver_stats.h"
+#include <optional>
 
 namespace kakuro {
 
-namespace {
-const Combinations kCombinations;
-}
+// Marks a cell that isn't trivial in ConstrainedBoard's dense triviality array.
+constexpr int kNotTrivial = -1;
+
+// Bit i is set if the i-th combination of a block's sum and size is still possible.
+using CombinationMask = uint16_t;
+static_assert(kCombinations.MaxNumCombinations() <= 16, "CombinationMask is too narrow");
 
 struct CellConstraints {
   Numbers numberCandidates;
@@ -16,29 +22,58 @@ struct CellConstraints {
   Numbers columnBlockNumbers;
 };
 
-struct TrivialityChange {
+// A single change recorded on the undo trail of a ConstrainedBoard.
+struct TrailEntry {
+  enum class Type { kNumberCandidates, kTriviality, kBlockCombinations };
+
+  Type type;
   const Cell* cell;
-  std::optional<int> previousTriviality;
+  Numbers previousNumberCandidates; // for kNumberCandidates
+  int previousTriviality; // for kTriviality, kNotTrivial if the cell wasn't trivial
+  bool isRow; // for kBlockCombinations
+  CombinationMask previousCombinations; // for kBlockCombinations
 };
 
+// Undo contexts only remember where on the trail their changes start, so they must be undone in the
+// reverse order they were created in.
 struct FillNumberUndoContext {
   const Cell* cell;
-  Numbers previousNumberCandidates;
-  std::vector<const Cell*> candidatesRemoved;
-  std::vector<TrivialityChange> trivialityChanges;
+  std::size_t trailMark;
 };
 
 struct SetSumUndoContext {
   const Cell* cell;
-  std::vector<class Numbers> numberCandidates;
-  std::vector<TrivialityChange> trivialityChanges;
   bool isRow;
+  std::size_t trailMark;
 };
 
 class ConstrainedBoard {
 public:
-  ConstrainedBoard(Board& board)
-      : board_{board}, cellConstraints_{static_cast<std::size_t>(board.Rows() * board.Columns())} {
+  // With combinationPropagation, every block with a sum additionally tracks which of its sum's
+  // combinations are still possible, and restricts its cells to the numbers of those combinations.
+  // This prunes a lot more than the default propagation, at a higher cost per change.
+  ConstrainedBoard(Board& board, bool combinationPropagation = false)
+      : board_{board},
+        combinationPropagation_{combinationPropagation},
+        cellConstraints_{static_cast<std::size_t>(board.Rows() * board.Columns())},
+        numberCandidatesRemoved_{static_cast<std::size_t>(board.Rows() * board.Columns())},
+        rowBlockNumberCandidatesRemoved_{static_cast<std::size_t>(board.Rows() * board.Columns())},
+        columnBlockNumberCandidatesRemoved_{
+            static_cast<std::size_t>(board.Rows() * board.Columns())},
+        triviality_(static_cast<std::size_t>(board.Rows() * board.Columns()), kNotTrivial),
+        previousTrivialCell_(static_cast<std::size_t>(board.Rows() * board.Columns()), -1),
+        nextTrivialCell_(static_cast<std::size_t>(board.Rows() * board.Columns()), -1),
+        firstTrivialCell_{-1},
+        lastTrivialCell_{-1},
+        numTrivialCells_{0},
+        rowBlockCombinations_(static_cast<std::size_t>(board.Rows() * board.Columns()), 0),
+        columnBlockCombinations_(static_cast<std::size_t>(board.Rows() * board.Columns()), 0) {
+    int numCells = board_.Rows() * board_.Columns();
+    trail_.reserve(4 * numCells);
+    cellsWithNumberCandidatesRemoved_.reserve(numCells);
+    rowBlocksWithNumberCandidatesRemoved_.reserve(numCells);
+    columnBlocksWithNumberCandidatesRemoved_.reserve(numCells);
+
     for (int row = 0; row < board_.Rows(); row++) {
       for (int column = 0; column < board.Columns(); column++) {
         const auto& cell = board_(row, column);
@@ -49,6 +84,20 @@ public:
       }
     }
 
+    // All combinations are possible before any cells are constrained, and filled cells already
+    // filter them below.
+    auto nonemptyBlocks = board_.FindNonemptyBlockCells();
+    if (combinationPropagation_) {
+      for (const auto* cellPointer : nonemptyBlocks) {
+        for (bool isRow : {true, false}) {
+          if (cellPointer->BlockSum(isRow) > 0) {
+            BlockCombinationMasks(isRow)[board_.Index(*cellPointer)] =
+                AllCombinations(*cellPointer, isRow);
+          }
+        }
+      }
+    }
+
     // Go over all filled cells and update constraints as if the cell was just filled.
     // Since trivial computation depends on block numbers, we need to fill those first.
     auto filledCells = board_.FindFilledCells();
@@ -63,7 +112,6 @@ public:
     }
 
     // Go over all nonempty blocks and update sum constraints as if the sum was just filled.
-    auto nonemptyBlocks = board_.FindNonemptyBlockCells();
     for (const auto* cellPointer : nonemptyBlocks) {
       const auto& cell = *cellPointer;
       if (cell.IsRowBlock() && cell.rowBlockSum > 0) {
@@ -73,18 +121,56 @@ public:
         UpdateBlockSumSetConstraints(cell, /* isRow */ false);
       }
     }
+
+    // The initial constraints are never undone.
+    trail_.clear();
   }
 
   Board& UnderlyingBoard() { return board_; }
+  const Board& UnderlyingBoard() const { return board_; }
+
+  bool CombinationPropagation() const { return combinationPropagation_; }
+
+  // Counts detected contradictions by cause into the given stats, or stops counting if null.
+  void SetStats(SolverStats* stats) { stats_.Attach(stats); }
+
+  SolverStats* Stats() const { return stats_.Get(); }
+
+  // Returns which combinations of the block's sum are still possible. Only tracked with
+  // combinationPropagation.
+  CombinationMask RemainingCombinations(const Cell& block, bool isRow) const {
+    return (isRow ? rowBlockCombinations_ : columnBlockCombinations_)[board_.Index(block)];
+  }
+
+  bool HasTrivialCells() const { return numTrivialCells_ > 0; }
 
-  const std::unordered_map<const Cell*, int>& TrivialCells() const { return trivialCells_; }
+  // Returns the trivial cell that has been trivial the longest, along with its trivial number.
+  std::pair<const Cell*, int> NextTrivialCell() const {
+    assert(HasTrivialCells());
+    return {&board_[firstTrivialCell_], triviality_[firstTrivialCell_]};
+  }
+
+  std::optional<int> Triviality(const Cell& cell) const {
+    int triviality = triviality_[board_.Index(cell)];
+    if (triviality == kNotTrivial) {
+      return std::nullopt;
+    }
+    return triviality;
+  }
 
-  CellConstraints& Constraints(const Cell& cell) {
-    return cellConstraints_[cell.row * board_.Columns() + cell.column];
+  // Returns all trivial cells in the order they will be returned by NextTrivialCell.
+  std::vector<std::pair<const Cell*, int>> TrivialCells() const {
+    std::vector<std::pair<const Cell*, int>> trivialCells;
+    for (int index = firstTrivialCell_; index != -1; index = nextTrivialCell_[index]) {
+      trivialCells.emplace_back(&board_[index], triviality_[index]);
+    }
+    return trivialCells;
   }
 
+  CellConstraints& Constraints(const Cell& cell) { return cellConstraints_[board_.Index(cell)]; }
+
   const CellConstraints& Constraints(const Cell& cell) const {
-    return cellConstraints_[cell.row * board_.Columns() + cell.column];
+    return cellConstraints_[board_.Index(cell)];
   }
 
   std::optional<int> IsTrivialCell(const Cell& cell) {
@@ -107,6 +193,7 @@ public:
     if (rowBlock.rowBlockSum > 0 && rowBlock.rowBlockFree == 1) {
       int leftover = rowBlock.rowBlockSum - Constraints(rowBlock).rowBlockNumbers.Sum();
       if (leftover < 1 || leftover > 9) {
+        stats_.CountContradiction(Contradiction::kSumLeftover);
         return 0; // contradiction
       }
       return leftover;
@@ -117,6 +204,7 @@ public:
     if (columnBlock.columnBlockSum > 0 && columnBlock.columnBlockFree == 1) {
       int leftover = columnBlock.columnBlockSum - Constraints(columnBlock).columnBlockNumbers.Sum();
       if (leftover < 1 || leftover > 9) {
+        stats_.CountContradiction(Contradiction::kSumLeftover);
         return 0; // contradiction
       }
       return leftover;
@@ -125,30 +213,29 @@ public:
     return std::nullopt;
   }
 
-  TrivialityChange ChangeTriviality(const Cell& cell, std::optional<int> trivial) {
-    TrivialityChange change;
+  void ChangeTriviality(const Cell& cell, std::optional<int> trivial) {
+    TrailEntry change;
+    change.type = TrailEntry::Type::kTriviality;
     change.cell = &cell;
 
-    auto trivialityQuery = trivialCells_.find(&cell);
-    if (trivialityQuery != trivialCells_.end()) {
-      change.previousTriviality = trivialityQuery->second;
-    } else {
-      change.previousTriviality = std::nullopt;
-    }
+    int index = board_.Index(cell);
+    change.previousTriviality = triviality_[index];
+    trail_.push_back(change);
 
     if (trivial) {
-      if (change.previousTriviality && change.previousTriviality != *trivial) {
+      if (change.previousTriviality != kNotTrivial && change.previousTriviality != *trivial) {
         // If it was already trivial before but is now trivial different, this is a contradiction,
         // which we'll mark as trivially zero.
-        trivialCells_[&cell] = 0;
+        if (change.previousTriviality != 0 && *trivial != 0) {
+          stats_.CountContradiction(Contradiction::kConflictingTrivial);
+        }
+        SetTriviality(index, 0);
       } else {
-        trivialCells_[&cell] = *trivial;
+        SetTriviality(index, *trivial);
       }
     } else {
-      trivialCells_.erase(&cell);
+      SetTriviality(index, kNotTrivial);
     }
-
-    return change;
   }
 
   bool FillNumber(const Cell& cell, int number, FillNumberUndoContext& undo) {
@@ -194,21 +281,18 @@ public:
       }
     }
 
+    undo.cell = &cell;
+    undo.trailMark = trail_.size();
     board_.SetNumber(cell, number);
-    undo = UpdateCellFilledConstraints(cell);
+    UpdateCellFilledConstraints(cell);
     return true;
   }
 
-  FillNumberUndoContext UpdateCellFilledConstraints(const Cell& cell) {
-    assert(numberCandidatesRemoved_.empty());
-    CellConstraints& constraints = Constraints(cell);
-
-    FillNumberUndoContext undo;
-    undo.cell = &cell;
-    undo.previousNumberCandidates = constraints.numberCandidates;
+  void UpdateCellFilledConstraints(const Cell& cell) {
+    assert(cellsWithNumberCandidatesRemoved_.empty());
 
     // Remove all number candidates.
-    constraints.numberCandidates.Clear();
+    ChangeNumberCandidates(cell, Numbers{});
 
     const auto& rowBlock = board_.RowBlock(cell);
     const auto& columnBlock = board_.ColumnBlock(cell);
@@ -223,29 +307,40 @@ public:
 
       auto& currentCellConstraints = Constraints(currentCell);
       if (currentCellConstraints.numberCandidates.Has(cell.number)) {
-        undo.candidatesRemoved.emplace_back(&currentCell);
-        currentCellConstraints.numberCandidates.Remove(cell.number);
-        numberCandidatesRemoved_[&currentCell].Add(cell.number);
+        Numbers numberCandidates{currentCellConstraints.numberCandidates};
+        numberCandidates.Remove(cell.number);
+        ChangeNumberCandidates(currentCell, numberCandidates);
       }
 
       auto trivial = IsTrivialCell(currentCell);
       if (trivial) {
-        undo.trivialityChanges.emplace_back(ChangeTriviality(currentCell, trivial));
+        ChangeTriviality(currentCell, trivial);
       }
     };
     board_.ForEachBlockCell(columnBlock, /* isRow */ false, removeNumberCandidate);
     board_.ForEachBlockCell(rowBlock, /* isRow */ true, removeNumberCandidate);
 
     // A filled cell cannot be trivial anymore
-    undo.trivialityChanges.emplace_back(ChangeTriviality(cell, std::nullopt));
-
-    auto numberCandidatesRemovedTrivialityChanges = UpdateNumberCandidatesRemovedConstraints();
-    undo.trivialityChanges.insert(
-        undo.trivialityChanges.end(),
-        numberCandidatesRemovedTrivialityChanges.begin(),
-        numberCandidatesRemovedTrivialityChanges.end());
+    ChangeTriviality(cell, std::nullopt);
+
+    if (combinationPropagation_) {
+      // The blocks' combinations must now contain the filled number, even if no other cell had it
+      // as a candidate.
+      Numbers filledNumber;
+      filledNumber.Add(cell.number);
+      MarkBlockNumberCandidatesRemoved(
+          rowBlock,
+          filledNumber,
+          rowBlockNumberCandidatesRemoved_,
+          rowBlocksWithNumberCandidatesRemoved_);
+      MarkBlockNumberCandidatesRemoved(
+          columnBlock,
+          filledNumber,
+          columnBlockNumberCandidatesRemoved_,
+          columnBlocksWithNumberCandidatesRemoved_);
+    }
 
-    return undo;
+    UpdateNumberCandidatesRemovedConstraints();
   }
 
   void UndoFillNumber(const FillNumberUndoContext& undo) {
@@ -256,26 +351,9 @@ public:
     Constraints(rowBlock).rowBlockNumbers.Remove(cell.number);
     Constraints(columnBlock).columnBlockNumbers.Remove(cell.number);
 
-    int number = cell.number;
     board_.SetNumber(cell, /* number */ 0);
 
-    for (const auto* currentCellPointer : undo.candidatesRemoved) {
-      const Cell& currentCell = *currentCellPointer;
-      Constraints(currentCell).numberCandidates.Add(number);
-    }
-
-    // Restore previous number candidates for cell itself.
-    Constraints(cell).numberCandidates = undo.previousNumberCandidates;
-
-    for (auto iter = undo.trivialityChanges.rbegin(); iter != undo.trivialityChanges.rend();
-         ++iter) {
-      const Cell& currentCell = *iter->cell;
-      if (iter->previousTriviality) {
-        trivialCells_[&currentCell] = *iter->previousTriviality;
-      } else {
-        trivialCells_.erase(&currentCell);
-      }
-    }
+    UndoTrail(undo.trailMark);
   }
 
   // Doesn't currently check if the sum is at all possible for this block in terms of combinations.
@@ -286,25 +364,24 @@ public:
     assert(sum < 46);
 
     const auto& combinations = kCombinations.PerSizePerSum(sum, cell.BlockSize(isRow));
-    if (combinations.numberCombinations.empty()) {
+    if (combinations.Empty()) {
       return false;
     }
 
     undo.cell = &cell;
-    undo.numberCandidates.clear();
     undo.isRow = isRow;
+    undo.trailMark = trail_.size();
 
     board_.SetBlockSum(cell, isRow, sum);
-    undo = UpdateBlockSumSetConstraints(cell, isRow);
+    if (combinationPropagation_) {
+      ChangeBlockCombinations(cell, isRow, AllCombinations(cell, isRow));
+    }
+    UpdateBlockSumSetConstraints(cell, isRow);
     return true;
   }
 
-  SetSumUndoContext UpdateBlockSumSetConstraints(const Cell& cell, bool isRow) {
-    assert(numberCandidatesRemoved_.empty());
-
-    SetSumUndoContext undo;
-    undo.cell = &cell;
-    undo.isRow = isRow;
+  void UpdateBlockSumSetConstraints(const Cell& cell, bool isRow) {
+    assert(cellsWithNumberCandidatesRemoved_.empty());
 
     const auto& combinations =
         kCombinations.PerSizePerSum(cell.BlockSum(isRow), cell.BlockSize(isRow));
@@ -318,8 +395,11 @@ public:
       }
 
       auto& currentCellConstraints = Constraints(currentCell);
-      undo.numberCandidates.push_back(currentCellConstraints.numberCandidates);
-      currentCellConstraints.numberCandidates.And(combinations.possibleNumbers);
+      Numbers numberCandidates{currentCellConstraints.numberCandidates};
+      numberCandidates.And(combinations.possibleNumbers);
+      if (!(numberCandidates == currentCellConstraints.numberCandidates)) {
+        ChangeNumberCandidates(currentCell, numberCandidates);
+      }
 
       // Count how many cells in this block provide each number candidate so we can check if one
       // became trivial because of this sum set below.
@@ -329,18 +409,10 @@ public:
             lastNumberCandidate[number] = &currentCell;
           });
 
-      // Check if any number candidates were removed and add to set of cells to update constraints
-      // for below.
-      Numbers removedNumberCandidates{undo.numberCandidates.back()};
-      removedNumberCandidates.Xor(currentCellConstraints.numberCandidates);
-      if (removedNumberCandidates.Count()) {
-        numberCandidatesRemoved_[&currentCell].Or(removedNumberCandidates);
-      }
-
       // Check if cell became trivial because we set the block sum.
       auto trivial = IsTrivialCell(currentCell);
       if (trivial) {
-        undo.trivialityChanges.emplace_back(ChangeTriviality(currentCell, trivial));
+        ChangeTriviality(currentCell, trivial);
       }
     });
 
@@ -351,171 +423,447 @@ public:
         const Cell& currentCell = *lastNumberCandidate[number];
         if (currentCell.IsFree()) {
           // We know we need this number but there is only one candidate for it, so it must be here!
-          undo.trivialityChanges.emplace_back(ChangeTriviality(currentCell, number));
+          ChangeTriviality(currentCell, number);
         }
       }
     });
 
-    auto numberCandidatesRemovedTrivialityChanges = UpdateNumberCandidatesRemovedConstraints();
-    undo.trivialityChanges.insert(
-        undo.trivialityChanges.end(),
-        numberCandidatesRemovedTrivialityChanges.begin(),
-        numberCandidatesRemovedTrivialityChanges.end());
+    if (combinationPropagation_) {
+      PropagateBlockCombinations(cell, isRow);
+    }
 
-    return undo;
+    UpdateNumberCandidatesRemovedConstraints();
   }
 
   void UndoSetSum(const SetSumUndoContext& undo) {
-    auto& cell = *undo.cell;
-    int i = 0;
+    board_.SetBlockSum(*undo.cell, undo.isRow, 0);
 
-    board_.SetBlockSum(cell, undo.isRow, 0);
-    board_.ForEachBlockCell(cell, undo.isRow, [this, &i, &undo](const Cell& currentCell) {
-      Constraints(currentCell).numberCandidates = undo.numberCandidates[i];
-      i++;
-    });
-
-    for (auto iter = undo.trivialityChanges.rbegin(); iter != undo.trivialityChanges.rend();
-         ++iter) {
-      const Cell& currentCell = *iter->cell;
-      if (iter->previousTriviality) {
-        trivialCells_[&currentCell] = *iter->previousTriviality;
-      } else {
-        trivialCells_.erase(&currentCell);
-      }
-    }
+    UndoTrail(undo.trailMark);
   }
 
-  // Returns a list of cells made trivial by the constraint updates.
-  std::vector<TrivialityChange> UpdateNumberCandidatesRemovedConstraints() {
-    std::vector<TrivialityChange> trivialityChanges;
-
-    // First, gather all affected blocks and compute which numbers got removed from cells in the
-    // block.
-    std::unordered_map<const Cell*, Numbers> rowBlockNumberCandidatesRemoved;
-    std::unordered_map<const Cell*, Numbers> columnBlockNumberCandidatesRemoved;
-    for (auto entry : numberCandidatesRemoved_) {
-      const auto& cell = *entry.first;
-      const auto& numberCandidatesRemoved = entry.second;
-      rowBlockNumberCandidatesRemoved[&board_.RowBlock(cell)].Or(numberCandidatesRemoved);
-      columnBlockNumberCandidatesRemoved[&board_.ColumnBlock(cell)].Or(numberCandidatesRemoved);
-    }
-
-    // Second, for each affected block check if the removed number is now only a candidate in one
-    // cell, which would make that cell trivial.
-    // Also check if existing sum constraints are even possible still.
-    auto updateBlockNumberCandidatesRemovedConstraints =
-        [&](const std::unordered_map<const Cell*, Numbers>& blockNumberCandidatesRemoved,
-            bool isRow) {
-          for (auto entry : blockNumberCandidatesRemoved) {
-            const auto& cell = *entry.first;
-            int sum = cell.BlockSum(isRow);
-            const auto& numberCandidatesRemoved = entry.second;
-
-            // Check if any of the removed number candidates were necessary.
-            const auto& combinations = kCombinations.PerSizePerSum(sum, cell.BlockSize(isRow));
-            Numbers necessaryRemovedCandidates{numberCandidatesRemoved};
-            necessaryRemovedCandidates.And(combinations.necessaryNumbers);
-
-            // Check if any of the numbers that were removed from cells in this block but are
-            // necessary are now only possible for a single cell.
-            necessaryRemovedCandidates.ForEachTrue([&](int number) {
-              const Cell* lastCell = nullptr;
-              int numCells = 0;
-              board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
-                if (currentCell.number == number ||
-                    Constraints(currentCell).numberCandidates.Has(number)) {
-                  lastCell = &currentCell;
-                  numCells++;
-                }
-              });
-
-              if (numCells == 1) {
-                if (lastCell->IsFree()) {
-                  // We know we need this number but there is only one candidate for it, so it must
-                  // be here!
-                  trivialityChanges.emplace_back(ChangeTriviality(*lastCell, number));
-                }
-              } else if (numCells == 0) {
-                // This is a contradiction, we need this number but there is no available cell for
-                // it.
+  // Checks the blocks of all cells that had number candidates removed since the last call, and
+  // marks any cells that became trivial because of it.
+  void UpdateNumberCandidatesRemovedConstraints() {
+    // Combination propagation can remove further number candidates, so repeat until it doesn't.
+    do {
+      // First, gather all affected blocks and compute which numbers got removed from cells in the
+      // block.
+      for (const Cell* cellPointer : cellsWithNumberCandidatesRemoved_) {
+        const auto& cell = *cellPointer;
+        auto& numberCandidatesRemoved = numberCandidatesRemoved_[board_.Index(cell)];
+        MarkBlockNumberCandidatesRemoved(
+            board_.RowBlock(cell),
+            numberCandidatesRemoved,
+            rowBlockNumberCandidatesRemoved_,
+            rowBlocksWithNumberCandidatesRemoved_);
+        MarkBlockNumberCandidatesRemoved(
+            board_.ColumnBlock(cell),
+            numberCandidatesRemoved,
+            columnBlockNumberCandidatesRemoved_,
+            columnBlocksWithNumberCandidatesRemoved_);
+        numberCandidatesRemoved.Clear();
+      }
+      cellsWithNumberCandidatesRemoved_.clear();
+
+      // Second, for each affected block check if the removed number is now only a candidate in one
+      // cell, which would make that cell trivial.
+      // Also check if existing sum constraints are even possible still.
+      auto updateBlockNumberCandidatesRemovedConstraints =
+          [&](std::vector<Numbers>& blockNumberCandidatesRemoved,
+              std::vector<const Cell*>& blocksWithNumberCandidatesRemoved,
+              bool isRow) {
+            for (const Cell* cellPointer : blocksWithNumberCandidatesRemoved) {
+              const auto& cell = *cellPointer;
+              int sum = cell.BlockSum(isRow);
+              Numbers numberCandidatesRemoved{blockNumberCandidatesRemoved[board_.Index(cell)]};
+              blockNumberCandidatesRemoved[board_.Index(cell)].Clear();
+
+              // Check if any of the removed number candidates were necessary.
+              const auto& combinations = kCombinations.PerSizePerSum(sum, cell.BlockSize(isRow));
+              Numbers necessaryRemovedCandidates{numberCandidatesRemoved};
+              necessaryRemovedCandidates.And(combinations.necessaryNumbers);
+
+              // Check if any of the numbers that were removed from cells in this block but are
+              // necessary are now only possible for a single cell.
+              necessaryRemovedCandidates.ForEachTrue([&](int number) {
+                const Cell* lastCell = nullptr;
+                int numCells = 0;
                 board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
-                  if (currentCell.IsFree()) {
-                    trivialityChanges.emplace_back(ChangeTriviality(currentCell, 0));
+                  if (currentCell.number == number ||
+                      Constraints(currentCell).numberCandidates.Has(number)) {
+                    lastCell = &currentCell;
+                    numCells++;
                   }
                 });
-              }
-            });
-
-            if (sum > 0) {
-              int minSum = 0;
-              int maxSum = 0;
-              board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
-                if (currentCell.IsFilled()) {
-                  minSum += currentCell.number;
-                  maxSum += currentCell.number;
-                } else {
-                  minSum += Constraints(currentCell).numberCandidates.Min();
-                  maxSum += Constraints(currentCell).numberCandidates.Max();
+
+                if (numCells == 1) {
+                  if (lastCell->IsFree()) {
+                    // We know we need this number but there is only one candidate for it, so it
+                    // must be here!
+                    ChangeTriviality(*lastCell, number);
+                  }
+                } else if (numCells == 0) {
+                  // This is a contradiction, we need this number but there is no available cell for
+                  // it.
+                  stats_.CountContradiction(Contradiction::kNecessaryNumberMissing);
+                  board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
+                    if (currentCell.IsFree()) {
+                      ChangeTriviality(currentCell, 0);
+                    }
+                  });
                 }
               });
 
-              if (sum < minSum || sum > maxSum) {
-                // This sum isn't possible with the available numbers, so this must be a
-                // contradiction!
+              if (sum > 0) {
+                int minSum = 0;
+                int maxSum = 0;
                 board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
-                  if (currentCell.IsFree()) {
-                    trivialityChanges.emplace_back(ChangeTriviality(currentCell, 0));
+                  if (currentCell.IsFilled()) {
+                    minSum += currentCell.number;
+                    maxSum += currentCell.number;
+                  } else {
+                    minSum += Constraints(currentCell).numberCandidates.Min();
+                    maxSum += Constraints(currentCell).numberCandidates.Max();
                   }
                 });
+
+                if (sum < minSum || sum > maxSum) {
+                  // This sum isn't possible with the available numbers, so this must be a
+                  // contradiction!
+                  stats_.CountContradiction(Contradiction::kSumBounds);
+                  board_.ForEachBlockCell(cell, isRow, [&](const Cell& currentCell) {
+                    if (currentCell.IsFree()) {
+                      ChangeTriviality(currentCell, 0);
+                    }
+                  });
+                }
+              }
+
+              if (combinationPropagation_ && sum > 0) {
+                PropagateBlockCombinations(cell, isRow);
               }
             }
-          }
-        };
-    updateBlockNumberCandidatesRemovedConstraints(
-        rowBlockNumberCandidatesRemoved, /* isRow */ true);
-    updateBlockNumberCandidatesRemovedConstraints(
-        columnBlockNumberCandidatesRemoved, /* isRow */ false);
-
-    numberCandidatesRemoved_.clear();
-    return trivialityChanges;
+            blocksWithNumberCandidatesRemoved.clear();
+          };
+      updateBlockNumberCandidatesRemovedConstraints(
+          rowBlockNumberCandidatesRemoved_,
+          rowBlocksWithNumberCandidatesRemoved_,
+          /* isRow */ true);
+      updateBlockNumberCandidatesRemovedConstraints(
+          columnBlockNumberCandidatesRemoved_,
+          columnBlocksWithNumberCandidatesRemoved_,
+          /* isRow */ false);
+    } while (!cellsWithNumberCandidatesRemoved_.empty());
   }
 
   void Dump(std::string prefix, int index) const {
     std::ofstream outputFile{prefix + std::to_string(index) + ".html"};
     if (outputFile) {
-      board_.RenderHtml(outputFile, [this](std::ostream& output, const Cell& cell) {
-        if (cell.number > 0) {
-          output << cell.number;
-        } else {
-          auto trivialQuery = trivialCells_.find(&cell);
-          if (trivialQuery == trivialCells_.end()) {
-            for (int i = 1; i <= 9; i++) {
-              if (Constraints(cell).numberCandidates.Has(i)) {
-                output << i << "?";
-              }
-            }
-          } else {
-            int trivial = trivialQuery->second;
-            if (trivial == 0) {
-              output << "↯";
-            } else {
-              output << trivial << "!";
-            }
-          }
-        }
+      BoardRenderer renderer;
+      renderer.Render(board_, [this](std::string& output, const Cell& cell) {
+        int triviality = triviality_[board_.Index(cell)];
+        PrintCellState(output, cell.number, Constraints(cell).numberCandidates, triviality);
       });
+      renderer.WriteTo(outputFile);
+    }
+  }
+
+  // Prints a free cell for Dump: its number if filled, otherwise its trivial number or its number
+  // candidates.
+  static void PrintCellState(
+      std::string& output, int number, Numbers numberCandidates, int triviality) {
+    if (number > 0) {
+      BoardRenderer::AppendInteger(output, number);
+    } else if (triviality == kNotTrivial) {
+      for (int i = 1; i <= 9; i++) {
+        if (numberCandidates.Has(i)) {
+          BoardRenderer::AppendInteger(output, i);
+          output += "?";
+        }
+      }
+    } else if (triviality == 0) {
+      output += "↯";
+    } else {
+      BoardRenderer::AppendInteger(output, triviality);
+      output += "!";
     }
   }
 
 private:
+  // Changes the number candidates of a cell, recording the previous ones on the trail and
+  // remembering which were removed for UpdateNumberCandidatesRemovedConstraints.
+  void ChangeNumberCandidates(const Cell& cell, Numbers numberCandidates) {
+    auto& constraints = Constraints(cell);
+
+    TrailEntry change;
+    change.type = TrailEntry::Type::kNumberCandidates;
+    change.cell = &cell;
+    change.previousNumberCandidates = constraints.numberCandidates;
+    trail_.push_back(change);
+
+    // Counted here rather than in IsTrivialCell, which rechecks cells that are already empty.
+    if (numberCandidates.Count() == 0 && constraints.numberCandidates.Count() > 0 &&
+        !cell.IsFilled()) {
+      stats_.CountContradiction(Contradiction::kNoCandidates);
+    }
+
+    Numbers removedNumberCandidates{constraints.numberCandidates};
+    removedNumberCandidates.Xor(numberCandidates);
+    removedNumberCandidates.And(constraints.numberCandidates);
+    constraints.numberCandidates = numberCandidates;
+
+    // A filled cell's candidates don't matter to its blocks anymore.
+    if (removedNumberCandidates.Count() > 0 && !cell.IsFilled()) {
+      auto& numberCandidatesRemoved = numberCandidatesRemoved_[board_.Index(cell)];
+      if (numberCandidatesRemoved.Count() == 0) {
+        cellsWithNumberCandidatesRemoved_.push_back(&cell);
+      }
+      numberCandidatesRemoved.Or(removedNumberCandidates);
+    }
+  }
+
+  std::vector<CombinationMask>& BlockCombinationMasks(bool isRow) {
+    return isRow ? rowBlockCombinations_ : columnBlockCombinations_;
+  }
+
+  static CombinationMask AllCombinations(const Cell& block, bool isRow) {
+    const auto& combinations =
+        kCombinations.PerSizePerSum(block.BlockSum(isRow), block.BlockSize(isRow));
+    return static_cast<CombinationMask>((1u << combinations.numCombinations) - 1);
+  }
+
+  void ChangeBlockCombinations(const Cell& block, bool isRow, CombinationMask combinations) {
+    auto& blockCombinations = BlockCombinationMasks(isRow)[board_.Index(block)];
+
+    TrailEntry change;
+    change.type = TrailEntry::Type::kBlockCombinations;
+    change.cell = &block;
+    change.isRow = isRow;
+    change.previousCombinations = blockCombinations;
+    trail_.push_back(change);
+
+    blockCombinations = combinations;
+  }
+
+  // Drops the block's combinations that are no longer possible given its filled numbers and the
+  // number candidates of its free cells. Each free cell is then restricted to the numbers it can
+  // take in some complete assignment of a remaining combination, and numbers needed by all of them
+  // that only one cell can provide make that cell trivial.
+  void PropagateBlockCombinations(const Cell& block, bool isRow) {
+    const auto& combinations =
+        kCombinations.PerSizePerSum(block.BlockSum(isRow), block.BlockSize(isRow));
+    const auto& blockConstraints = Constraints(block);
+    uint16_t filledBits =
+        (isRow ? blockConstraints.rowBlockNumbers : blockConstraints.columnBlockNumbers).Bits();
+
+    std::array<const Cell*, 9> freeCells;
+    std::array<uint16_t, 9> candidateBits;
+    int numFreeCells = 0;
+    board_.ForEachBlockCell(block, isRow, [&](const Cell& currentCell) {
+      if (currentCell.IsFree()) {
+        freeCells[numFreeCells] = &currentCell;
+        candidateBits[numFreeCells] = Constraints(currentCell).numberCandidates.Bits();
+        numFreeCells++;
+      }
+    });
+
+    CombinationMask previousCombinations = BlockCombinationMasks(isRow)[board_.Index(block)];
+    CombinationMask remainingCombinations = 0;
+    std::array<uint16_t, 9> supportedBits{};
+    uint16_t necessaryBits = Numbers::kAllBits;
+    auto numberCombinations = kCombinations.Of(combinations);
+    for (int i = 0; i < numberCombinations.size(); i++) {
+      if (!(previousCombinations & (1u << i))) {
+        continue;
+      }
+
+      // The combination must contain all filled numbers, and the free cells must be able to take
+      // the rest of them.
+      uint16_t combinationBits = numberCombinations[i].Bits();
+      if ((combinationBits & filledBits) != filledBits) {
+        continue;
+      }
+      uint16_t missingBits = combinationBits & ~filledBits;
+      if (!MatchMissingNumbers(missingBits, candidateBits, numFreeCells, supportedBits)) {
+        continue;
+      }
+
+      remainingCombinations |= static_cast<CombinationMask>(1u << i);
+      necessaryBits &= missingBits;
+    }
+
+    if (remainingCombinations != previousCombinations) {
+      ChangeBlockCombinations(block, isRow, remainingCombinations);
+    }
+
+    if (remainingCombinations == 0) {
+      // No combination of the sum fits anymore, so this must be a contradiction!
+      stats_.CountContradiction(Contradiction::kNoCombination);
+      for (int j = 0; j < numFreeCells; j++) {
+        ChangeTriviality(*freeCells[j], 0);
+      }
+      return;
+    }
+
+    std::array<int, 10> numberCandidateCounts{};
+    std::array<const Cell*, 10> lastNumberCandidate{};
+    for (int j = 0; j < numFreeCells; j++) {
+      const Cell& currentCell = *freeCells[j];
+      if (supportedBits[j] != candidateBits[j]) {
+        ChangeNumberCandidates(currentCell, Numbers::FromBits(supportedBits[j]));
+        auto trivial = IsTrivialCell(currentCell);
+        if (trivial) {
+          ChangeTriviality(currentCell, trivial);
+        }
+      }
+
+      Numbers::FromBits(supportedBits[j]).ForEachTrue([&](int number) {
+        numberCandidateCounts[number]++;
+        lastNumberCandidate[number] = &currentCell;
+      });
+    }
+
+    Numbers::FromBits(necessaryBits).ForEachTrue([&](int number) {
+      if (numberCandidateCounts[number] == 1) {
+        // Every remaining combination needs this number but only one cell can provide it.
+        ChangeTriviality(*lastNumberCandidate[number], number);
+      }
+    });
+  }
+
+  // Checks whether the free cells can take the missing numbers so that each cell gets exactly one
+  // of its candidates, and adds every number a cell takes in some such assignment to its supported
+  // numbers. Works on subsets of the missing numbers: a subset is reachable from the front if the
+  // first cells can take exactly its numbers, and from the back likewise for the last cells.
+  static bool MatchMissingNumbers(
+      uint16_t missingBits,
+      const std::array<uint16_t, 9>& candidateBits,
+      int numFreeCells,
+      std::array<uint16_t, 9>& supportedBits) {
+    if (kNumbersTables.count[missingBits] != numFreeCells) {
+      return false;
+    }
+
+    // Every subset is only read after all of its own subsets were written, so these don't need to
+    // be initialized.
+    std::array<bool, 512> reachableFromFront;
+    std::array<bool, 512> reachableFromBack;
+    for (unsigned subset = 0;; subset = (subset - missingBits) & missingBits) {
+      int size = kNumbersTables.count[subset];
+      bool front = size == 0;
+      bool back = size == 0;
+      for (unsigned bits = subset; bits != 0 && !(front && back); bits &= bits - 1) {
+        unsigned bit = bits & -bits;
+        front = front || (reachableFromFront[subset ^ bit] && (candidateBits[size - 1] & bit));
+        back = back ||
+            (reachableFromBack[subset ^ bit] && (candidateBits[numFreeCells - size] & bit));
+      }
+      reachableFromFront[subset] = front;
+      reachableFromBack[subset] = back;
+      if (subset == missingBits) {
+        break;
+      }
+    }
+
+    if (!reachableFromFront[missingBits]) {
+      return false;
+    }
+
+    // Cell j can take a number if the cells before it can take some subset of the other numbers
+    // and the cells after it the remaining ones.
+    for (unsigned subset = 0;; subset = (subset - missingBits) & missingBits) {
+      int j = kNumbersTables.count[subset];
+      if (j < numFreeCells && reachableFromFront[subset]) {
+        unsigned rest = missingBits & ~subset;
+        for (unsigned bits = rest & candidateBits[j] & ~supportedBits[j]; bits != 0;
+             bits &= bits - 1) {
+          unsigned bit = bits & -bits;
+          if (reachableFromBack[rest ^ bit]) {
+            supportedBits[j] |= bit;
+          }
+        }
+      }
+      if (subset == missingBits) {
+        break;
+      }
+    }
+    return true;
+  }
+
+  void MarkBlockNumberCandidatesRemoved(
+      const Cell& block,
+      const Numbers& numberCandidatesRemoved,
+      std::vector<Numbers>& blockNumberCandidatesRemoved,
+      std::vector<const Cell*>& blocksWithNumberCandidatesRemoved) {
+    auto& blockRemoved = blockNumberCandidatesRemoved[board_.Index(block)];
+    if (blockRemoved.Count() == 0) {
+      blocksWithNumberCandidatesRemoved.push_back(&block);
+    }
+    blockRemoved.Or(numberCandidatesRemoved);
+  }
+
+  // Updates the dense triviality array, appending cells that become trivial to the end of the
+  // trivial cell queue and unlinking cells that stop being trivial.
+  void SetTriviality(int index, int triviality) {
+    bool wasTrivial = triviality_[index] != kNotTrivial;
+    bool isTrivial = triviality != kNotTrivial;
+    triviality_[index] = triviality;
+
+    if (!wasTrivial && isTrivial) {
+      previousTrivialCell_[index] = lastTrivialCell_;
+      nextTrivialCell_[index] = -1;
+      if (lastTrivialCell_ == -1) {
+        firstTrivialCell_ = index;
+      } else {
+        nextTrivialCell_[lastTrivialCell_] = index;
+      }
+      lastTrivialCell_ = index;
+      numTrivialCells_++;
+    } else if (wasTrivial && !isTrivial) {
+      int previous = previousTrivialCell_[index];
+      int next = nextTrivialCell_[index];
+      if (previous == -1) {
+        firstTrivialCell_ = next;
+      } else {
+        nextTrivialCell_[previous] = next;
+      }
+      if (next == -1) {
+        lastTrivialCell_ = previous;
+      } else {
+        previousTrivialCell_[next] = previous;
+      }
+      numTrivialCells_--;
+    }
+  }
+
+  // Reverts all changes recorded on the trail since the given mark.
+  void UndoTrail(std::size_t trailMark) {
+    assert(trailMark <= trail_.size());
+    while (trail_.size() > trailMark) {
+      const TrailEntry& change = trail_.back();
+      const Cell& cell = *change.cell;
+      switch (change.type) {
+        case TrailEntry::Type::kNumberCandidates:
+          Constraints(cell).numberCandidates = change.previousNumberCandidates;
+          break;
+        case TrailEntry::Type::kTriviality:
+          SetTriviality(board_.Index(cell), change.previousTriviality);
+          break;
+        case TrailEntry::Type::kBlockCombinations:
+          BlockCombinationMasks(change.isRow)[board_.Index(cell)] = change.previousCombinations;
+          break;
+      }
+      trail_.pop_back();
+    }
+  }
+
   void AssertValidity() const {
 #ifdef NDEBUG
     return;
 #endif
     Dump("validity", 0);
 
-    ConstrainedBoard other{board_};
+    ConstrainedBoard other{board_, combinationPropagation_};
 
     for (int row = 0; row < board_.Rows(); row++) {
       for (int column = 0; column < board_.Columns(); column++) {
@@ -528,13 +876,35 @@ private:
       }
     }
 
-    assert(trivialCells_ == other.trivialCells_);
+    assert(triviality_ == other.triviality_);
   }
 
   Board& board_;
+  bool combinationPropagation_;
   std::vector<CellConstraints> cellConstraints_;
-  std::unordered_map<const Cell*, int> trivialCells_;
-  std::unordered_map<const Cell*, Numbers> numberCandidatesRemoved_;
+  std::vector<TrailEntry> trail_;
+
+  // Scratch space for UpdateNumberCandidatesRemovedConstraints, indexed by cell index.
+  std::vector<Numbers> numberCandidatesRemoved_;
+  std::vector<const Cell*> cellsWithNumberCandidatesRemoved_;
+  std::vector<Numbers> rowBlockNumberCandidatesRemoved_;
+  std::vector<const Cell*> rowBlocksWithNumberCandidatesRemoved_;
+  std::vector<Numbers> columnBlockNumberCandidatesRemoved_;
+  std::vector<const Cell*> columnBlocksWithNumberCandidatesRemoved_;
+
+  // Trivial number per cell index, with the trivial cells linked into a FIFO queue.
+  std::vector<int> triviality_;
+  std::vector<int> previousTrivialCell_;
+  std::vector<int> nextTrivialCell_;
+  int firstTrivialCell_;
+  int lastTrivialCell_;
+  int numTrivialCells_;
+
+  // Remaining combinations per block cell index, only tracked with combinationPropagation_.
+  std::vector<CombinationMask> rowBlockCombinations_;
+  std::vector<CombinationMask> columnBlockCombinations_;
+
+  StatsRecorder stats_;
 };
 
 } // namespace kakuro
@@ -0,0 +1,102 @@
+#include "constrained_board.h"
+
+#include <benchmark/benchmark.h>
+
+#include "board.h"
+#include "board_generator.h"
+#include <functional>
+#include <random>
+
+using namespace kakuro;
+
+namespace {
+
+Board GenerateBoard(int rows, int columns) {
+  std::mt19937 random;
+  random.seed(3);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  return boardGenerator.Generate(rows, columns);
+}
+
+std::vector<const Cell*> FindBlocks(const Board& board) {
+  std::vector<const Cell*> blocks;
+  for (int index = 0; index < board.Rows() * board.Columns(); index++) {
+    if (board[index].IsNonemptyBlock()) {
+      blocks.push_back(&board[index]);
+    }
+  }
+  return blocks;
+}
+
+// Computes the min/max sum of every block the way the propagation code does, either through an
+// inlinable lambda or through a std::function like Board's visitors used to take.
+template <bool kUseStdFunction>
+void BM_BlockMinMaxSums(benchmark::State& state) {
+  Board board = GenerateBoard(state.range(0), state.range(0));
+  ConstrainedBoard constrainedBoard{board};
+  auto blocks = FindBlocks(board);
+
+  for (auto _ : state) {
+    int totalMinSum = 0;
+    int totalMaxSum = 0;
+    for (const Cell* block : blocks) {
+      for (bool isRow : {true, false}) {
+        if (block->BlockSize(isRow) == 0) {
+          continue;
+        }
+
+        int minSum = 0;
+        int maxSum = 0;
+        auto addMinMax = [&](const Cell& currentCell) {
+          minSum += constrainedBoard.Constraints(currentCell).numberCandidates.Min();
+          maxSum += constrainedBoard.Constraints(currentCell).numberCandidates.Max();
+        };
+        if (kUseStdFunction) {
+          std::function<void(const Cell&)> callback{addMinMax};
+          board.ForEachBlockCell(*block, isRow, callback);
+        } else {
+          board.ForEachBlockCell(*block, isRow, addMinMax);
+        }
+        totalMinSum += minSum;
+        totalMaxSum += maxSum;
+      }
+    }
+    benchmark::DoNotOptimize(totalMinSum);
+    benchmark::DoNotOptimize(totalMaxSum);
+  }
+}
+BENCHMARK_TEMPLATE(BM_BlockMinMaxSums, false)->Arg(20)->Arg(40);
+BENCHMARK_TEMPLATE(BM_BlockMinMaxSums, true)->Arg(20)->Arg(40);
+
+// Fills every free cell with its smallest candidate and undoes all fills again, which exercises the
+// whole propagation kernel.
+void BM_FillNumberUndo(benchmark::State& state) {
+  Board board = GenerateBoard(state.range(0), state.range(0));
+  ConstrainedBoard constrainedBoard{board};
+  std::vector<const Cell*> cells;
+  for (int index = 0; index < board.Rows() * board.Columns(); index++) {
+    if (board[index].IsFree()) {
+      cells.push_back(&board[index]);
+    }
+  }
+  std::vector<FillNumberUndoContext> fills;
+  fills.reserve(cells.size());
+
+  for (auto _ : state) {
+    for (const Cell* cell : cells) {
+      int number = constrainedBoard.Constraints(*cell).numberCandidates.Min();
+      FillNumberUndoContext undo;
+      if (number > 0 && constrainedBoard.FillNumber(*cell, number, undo)) {
+        fills.push_back(undo);
+      }
+    }
+    for (auto iter = fills.rbegin(); iter != fills.rend(); ++iter) {
+      constrainedBoard.UndoFillNumber(*iter);
+    }
+    state.counters["fills"] = fills.size();
+    fills.clear();
+  }
+}
+BENCHMARK(BM_FillNumberUndo)->Arg(20)->Arg(40);
+
+} // namespace
@@ -12,6 +12,7 @@ using testing::Eq;
 using testing::IsEmpty;
 using testing::Not;
 using testing::UnorderedElementsAre;
+using testing::UnorderedElementsAreArray;
 
 // Test board:
 //   *********
@@ -36,6 +37,8 @@ TEST(ConstrainedBoardTest, Trivial) {
   ASSERT_THAT(
       constrainedBoard.TrivialCells(),
       UnorderedElementsAre(std::make_pair(&board(1, 8), 8), std::make_pair(&board(2, 1), 1)));
+  ASSERT_EQ(constrainedBoard.NextTrivialCell(), std::make_pair(&board(1, 8), 8))
+      << "trivial cells should be queued in the order they became trivial";
 
   FillNumberUndoContext undo;
   ASSERT_EQ(constrainedBoard.IsTrivialCell(board(1, 8)), 8)
@@ -70,6 +73,28 @@ TEST(ConstrainedBoardTest, InvalidTrivial) {
       constrainedBoard.TrivialCells(), UnorderedElementsAre(std::make_pair(&board(1, 1), 0)));
 }
 
+TEST(ConstrainedBoardTest, CountsNoCandidatesOnce) {
+  Board board{3, 3};
+  ConstrainedBoard constrainedBoard{board};
+  SolverStats stats;
+  constrainedBoard.SetStats(&stats);
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 3, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 3, sumUndo);
+
+  // Takes both of its candidates 1 and 2 away from the top left cell.
+  FillNumberUndoContext undo;
+  constrainedBoard.FillNumber(board(1, 2), 1, undo);
+  constrainedBoard.FillNumber(board(2, 1), 2, undo);
+  ASSERT_EQ(constrainedBoard.IsTrivialCell(board(1, 1)), 0);
+  ASSERT_EQ(constrainedBoard.IsTrivialCell(board(1, 1)), 0);
+
+#if KAKURO_SOLVER_STATS
+  EXPECT_EQ(stats.contradictions[static_cast<int>(Contradiction::kNoCandidates)], 1)
+      << "an empty cell must only be counted when it becomes empty, not when it is rechecked";
+#endif
+}
+
 TEST(ConstrainedBoardTest, TrivialAmbigous) {
   Board board{5, 4};
   board.MakeBlock(board(1, 1));
@@ -133,3 +158,95 @@ TEST(ConstrainedBoardTest, TrivialNecessary2) {
   ASSERT_THAT(
       constrainedBoard.TrivialCells(), UnorderedElementsAre(std::make_pair(&board(3, 3), 4)));
 }
+
+TEST(ConstrainedBoardTest, UndoRestoresConstraints) {
+  Board board{5, 6};
+  board.MakeBlock(board(3, 2));
+  board.MakeBlock(board(4, 2));
+  board.MakeBlock(board(1, 4));
+  board.MakeBlock(board(2, 4));
+  board.MakeBlock(board(1, 5));
+  board.MakeBlock(board(2, 5));
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 10, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 3, sumUndo);
+
+  auto assertSameConstraints = [&board, &constrainedBoard]() {
+    ConstrainedBoard expected{board};
+    for (int row = 0; row < board.Rows(); row++) {
+      for (int column = 0; column < board.Columns(); column++) {
+        const auto& cell = board(row, column);
+        ASSERT_EQ(
+            constrainedBoard.Constraints(cell).numberCandidates,
+            expected.Constraints(cell).numberCandidates);
+        ASSERT_EQ(
+            constrainedBoard.Constraints(cell).rowBlockNumbers,
+            expected.Constraints(cell).rowBlockNumbers);
+        ASSERT_EQ(
+            constrainedBoard.Constraints(cell).columnBlockNumbers,
+            expected.Constraints(cell).columnBlockNumbers);
+      }
+    }
+    ASSERT_THAT(
+        constrainedBoard.TrivialCells(), UnorderedElementsAreArray(expected.TrivialCells()));
+  };
+
+  SetSumUndoContext rowSumUndo;
+  ASSERT_TRUE(constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 6, rowSumUndo));
+  FillNumberUndoContext firstUndo;
+  ASSERT_TRUE(constrainedBoard.FillNumber(board(1, 1), 3, firstUndo));
+  FillNumberUndoContext secondUndo;
+  ASSERT_TRUE(constrainedBoard.FillNumber(board(2, 2), 2, secondUndo));
+
+  constrainedBoard.UndoFillNumber(secondUndo);
+  constrainedBoard.UndoFillNumber(firstUndo);
+  ASSERT_TRUE(board(1, 1).IsFree());
+  ASSERT_TRUE(board(2, 2).IsFree());
+  assertSameConstraints();
+
+  constrainedBoard.UndoSetSum(rowSumUndo);
+  ASSERT_EQ(board(1, 0).rowBlockSum, 0);
+  assertSameConstraints();
+}
+
+// Test board:
+//   ***
+//   *ab
+//   *cd
+//
+// The row sum 10 of a and b has the combinations 4+6, 3+7, 2+8 and 1+9, but the column sum 3 only
+// allows 1 or 2 for a. So only the last two combinations remain, which leaves 8 or 9 for b.
+TEST(ConstrainedBoardTest, CombinationPropagation) {
+  Board board{3, 3};
+  ConstrainedBoard constrainedBoard{board, /* combinationPropagation */ true};
+  SetSumUndoContext columnSumUndo;
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 3, columnSumUndo);
+  SetSumUndoContext rowSumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 10, rowSumUndo);
+
+  Numbers expected;
+  expected.Add(8);
+  expected.Add(9);
+  ASSERT_EQ(constrainedBoard.Constraints(board(1, 2)).numberCandidates, expected);
+  ASSERT_EQ(constrainedBoard.RemainingCombinations(board(1, 0), /* isRow */ true), 0b1100);
+
+  Board otherBoard{3, 3};
+  ConstrainedBoard otherConstrainedBoard{otherBoard};
+  otherConstrainedBoard.SetBlockSum(otherBoard(0, 1), /* isRow */ false, 3, columnSumUndo);
+  otherConstrainedBoard.SetBlockSum(otherBoard(1, 0), /* isRow */ true, 10, rowSumUndo);
+  ASSERT_TRUE(otherConstrainedBoard.Constraints(otherBoard(1, 2)).numberCandidates.Has(3))
+      << "default propagation should only apply the possible numbers of the sum";
+
+  FillNumberUndoContext undo;
+  ASSERT_TRUE(constrainedBoard.FillNumber(board(2, 1), 1, undo));
+  ASSERT_EQ(constrainedBoard.RemainingCombinations(board(1, 0), /* isRow */ true), 0b0100);
+  ASSERT_THAT(
+      constrainedBoard.TrivialCells(),
+      UnorderedElementsAre(std::make_pair(&board(1, 1), 2), std::make_pair(&board(1, 2), 8)));
+
+  constrainedBoard.UndoFillNumber(undo);
+  ASSERT_EQ(constrainedBoard.RemainingCombinations(board(1, 0), /* isRow */ true), 0b1100);
+  constrainedBoard.UndoSetSum(rowSumUndo);
+  ASSERT_EQ(constrainedBoard.RemainingCombinations(board(1, 0), /* isRow */ true), 0);
+}
@@ -0,0 +1,329 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "board.h"
+#include <climits>
+#include <cstdint>
+#include <fcntl.h>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace kakuro {
+
+// A corpus is a binary file of many puzzles, stored little endian:
+//
+//   header (32 bytes): uint32 magic, uint16 version, uint16 reserved, uint32 number of puzzles,
+//                      uint32 reserved, uint64 offset of the index table, uint64 reserved
+//   puzzle data:       per puzzle, its grid with two bytes per cell, followed by its solution with
+//                      four bits per cell if it has one
+//   index table:       per puzzle, a fixed-size record (24 bytes): uint64 offset of its data,
+//                      uint16 rows, uint16 columns, uint32 seed, uint32 flags, uint32 reserved
+//
+// In the grid, a free cell is stored as two zero bytes. A block cell is stored as its column block
+// sum with the top bit set, followed by its row block sum.
+namespace corpus {
+
+constexpr uint32_t kMagic = 0x43524b4b; // "KKRC"
+constexpr uint16_t kVersion = 1;
+constexpr std::size_t kHeaderSize = 32;
+constexpr std::size_t kIndexRecordSize = 24;
+constexpr uint32_t kHasSolution = 1;
+constexpr uint8_t kBlockBit = 0x80;
+
+inline std::size_t GridSize(int rows, int columns) {
+  return 2 * static_cast<std::size_t>(rows) * columns;
+}
+
+inline std::size_t SolutionSize(int rows, int columns) {
+  return (static_cast<std::size_t>(rows) * columns + 1) / 2;
+}
+
+inline void Put(std::string& output, uint64_t value, int numBytes) {
+  for (int i = 0; i < numBytes; i++) {
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+inline uint64_t Get(const uint8_t* data, int numBytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < numBytes; i++) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+} // namespace corpus
+
+// Writes puzzles to a corpus. The output must be seekable, since the header is only completed once
+// all puzzles are added in Finish.
+class CorpusWriter {
+public:
+  CorpusWriter(std::ostream& output) : output_{output}, offset_{corpus::kHeaderSize} {
+    std::string header(corpus::kHeaderSize, '\0');
+    output_.write(header.data(), header.size());
+  }
+
+  // Encodes the data of a puzzle, which can be done on any thread before adding it with AddEncoded.
+  static std::string Encode(const Board& board, bool withSolution) {
+    std::string data;
+    data.reserve(
+        corpus::GridSize(board.Rows(), board.Columns()) +
+        corpus::SolutionSize(board.Rows(), board.Columns()));
+    int numCells = board.Rows() * board.Columns();
+    for (int i = 0; i < numCells; i++) {
+      const Cell& cell = board[i];
+      if (cell.isBlock) {
+        data.push_back(static_cast<char>(corpus::kBlockBit | cell.columnBlockSum));
+        data.push_back(static_cast<char>(cell.rowBlockSum));
+      } else {
+        data.push_back('\0');
+        data.push_back('\0');
+      }
+    }
+
+    if (withSolution) {
+      for (int i = 0; i < numCells; i += 2) {
+        int low = board[i].isBlock ? 0 : board[i].number;
+        int high = i + 1 < numCells && !board[i + 1].isBlock ? board[i + 1].number : 0;
+        data.push_back(static_cast<char>(low | (high << 4)));
+      }
+    }
+    return data;
+  }
+
+  void Add(const Board& board, uint32_t seed = 0, bool withSolution = true) {
+    AddEncoded(board.Rows(), board.Columns(), seed, withSolution, Encode(board, withSolution));
+  }
+
+  void AddEncoded(
+      int rows, int columns, uint32_t seed, bool withSolution, const std::string& data) {
+    assert(
+        data.size() == corpus::GridSize(rows, columns) +
+            (withSolution ? corpus::SolutionSize(rows, columns) : 0));
+    output_.write(data.data(), data.size());
+
+    corpus::Put(index_, offset_, 8);
+    corpus::Put(index_, rows, 2);
+    corpus::Put(index_, columns, 2);
+    corpus::Put(index_, seed, 4);
+    corpus::Put(index_, withSolution ? corpus::kHasSolution : 0, 4);
+    corpus::Put(index_, 0, 4);
+    offset_ += data.size();
+  }
+
+  // Writes the index table and the header. Returns whether all writes succeeded.
+  bool Finish() {
+    output_.write(index_.data(), index_.size());
+
+    std::string header;
+    corpus::Put(header, corpus::kMagic, 4);
+    corpus::Put(header, corpus::kVersion, 2);
+    corpus::Put(header, 0, 2);
+    corpus::Put(header, index_.size() / corpus::kIndexRecordSize, 4);
+    corpus::Put(header, 0, 4);
+    corpus::Put(header, offset_, 8);
+    corpus::Put(header, 0, 8);
+    output_.seekp(0);
+    output_.write(header.data(), header.size());
+    output_.seekp(0, std::ios::end);
+    output_.flush();
+    return static_cast<bool>(output_);
+  }
+
+private:
+  std::ostream& output_;
+  uint64_t offset_;
+  std::string index_;
+};
+
+// A read-only view of a puzzle within a corpus, which points right into the corpus data.
+class PuzzleView {
+public:
+  PuzzleView(const uint8_t* data, int rows, int columns, uint32_t seed, bool hasSolution)
+      : data_{data}, rows_{rows}, columns_{columns}, seed_{seed}, hasSolution_{hasSolution} {}
+
+  int Rows() const { return rows_; }
+  int Columns() const { return columns_; }
+  uint32_t Seed() const { return seed_; }
+  bool HasSolution() const { return hasSolution_; }
+
+  bool IsBlock(int row, int column) const {
+    return data_[2 * Index(row, column)] & corpus::kBlockBit;
+  }
+
+  int ColumnBlockSum(int row, int column) const {
+    return data_[2 * Index(row, column)] & ~corpus::kBlockBit;
+  }
+
+  int RowBlockSum(int row, int column) const { return data_[2 * Index(row, column) + 1]; }
+
+  // Returns the solution number of a free cell, or zero without a solution.
+  int Number(int row, int column) const {
+    if (!hasSolution_) {
+      return 0;
+    }
+    int index = Index(row, column);
+    uint8_t packed = data_[corpus::GridSize(rows_, columns_) + index / 2];
+    return index % 2 == 0 ? packed & 0xf : packed >> 4;
+  }
+
+  // Builds a board with the puzzle's blocks and sums, and its solution if withSolution is set.
+  // Returns nothing if the puzzle data is corrupt, i.e. has sums above 45, numbers above 9 or
+  // blocks longer than nine cells. This is only checked here rather than when opening the corpus,
+  // so that opening stays cheap.
+  std::optional<Board> ToBoard(bool withSolution = false) const {
+    int numCells = rows_ * columns_;
+    std::vector<bool> isBlock(numCells);
+    std::vector<uint8_t> columnBlockSums(numCells);
+    std::vector<uint8_t> rowBlockSums(numCells);
+    std::vector<uint8_t> numbers;
+    for (int i = 0; i < numCells; i++) {
+      isBlock[i] = data_[2 * i] & corpus::kBlockBit;
+      columnBlockSums[i] = data_[2 * i] & ~corpus::kBlockBit;
+      rowBlockSums[i] = data_[2 * i + 1];
+      if (columnBlockSums[i] > 45 || rowBlockSums[i] > 45) {
+        return std::nullopt;
+      }
+    }
+    if (withSolution && hasSolution_) {
+      const uint8_t* solution = data_ + corpus::GridSize(rows_, columns_);
+      numbers.resize(numCells);
+      for (int i = 0; i < numCells; i++) {
+        numbers[i] = isBlock[i] ? 0 : (solution[i / 2] >> (4 * (i % 2))) & 0xf;
+        if (numbers[i] > 9) {
+          return std::nullopt;
+        }
+      }
+    }
+    auto board =
+        Board::FromBlockMask(rows_, columns_, isBlock, columnBlockSums, rowBlockSums, numbers);
+    for (int i = 0; i < numCells; i++) {
+      if (board[i].rowBlockSize > 9 || board[i].columnBlockSize > 9) {
+        return std::nullopt;
+      }
+    }
+    return board;
+  }
+
+private:
+  int Index(int row, int column) const { return row * columns_ + column; }
+
+  const uint8_t* data_;
+  int rows_;
+  int columns_;
+  uint32_t seed_;
+  bool hasSolution_;
+};
+
+// Reads a corpus by memory mapping it, so that opening it is cheap no matter how many puzzles it
+// has, and puzzles are only paged in once they are looked at.
+class CorpusReader {
+public:
+  CorpusReader() : data_{nullptr}, size_{0}, numPuzzles_{0}, index_{nullptr} {}
+
+  CorpusReader(const CorpusReader&) = delete;
+  CorpusReader& operator=(const CorpusReader&) = delete;
+
+  ~CorpusReader() { Close(); }
+
+  // Maps the given corpus file. Returns false if it can't be read or isn't a valid corpus.
+  bool Open(const std::string& filename) {
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(corpus::kHeaderSize)) {
+      close(fd);
+      return false;
+    }
+    size_ = fileStat.st_size;
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid without the file descriptor
+    if (data == MAP_FAILED) {
+      size_ = 0;
+      return false;
+    }
+    data_ = static_cast<const uint8_t*>(data);
+
+    if (!Validate()) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() {
+    if (data_ != nullptr) {
+      munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    numPuzzles_ = 0;
+    index_ = nullptr;
+  }
+
+  int Size() const { return numPuzzles_; }
+
+  // Returns a view of the i-th puzzle, or nothing if its index record is corrupt. Records are only
+  // checked here, so that opening doesn't have to go through all of them.
+  std::optional<PuzzleView> operator[](int i) const {
+    assert(i >= 0 && i < numPuzzles_);
+    const uint8_t* record = index_ + i * corpus::kIndexRecordSize;
+    uint64_t offset = corpus::Get(record, 8);
+    int rows = corpus::Get(record + 8, 2);
+    int columns = corpus::Get(record + 10, 2);
+    bool hasSolution = corpus::Get(record + 16, 4) & corpus::kHasSolution;
+    uint64_t indexOffset = index_ - data_;
+    if (rows < 1 || rows > INT16_MAX || columns < 1 || columns > INT16_MAX ||
+        offset < corpus::kHeaderSize || offset > indexOffset) {
+      return std::nullopt;
+    }
+    uint64_t dataSize = corpus::GridSize(rows, columns) +
+        (hasSolution ? corpus::SolutionSize(rows, columns) : 0);
+    if (indexOffset - offset < dataSize) {
+      return std::nullopt;
+    }
+    return PuzzleView{
+        data_ + offset,
+        rows,
+        columns,
+        static_cast<uint32_t>(corpus::Get(record + 12, 4)),
+        hasSolution};
+  }
+
+private:
+  // Checks the header and that the index lies within the file. The puzzles' records are checked
+  // when they are looked up.
+  bool Validate() {
+    if (corpus::Get(data_, 4) != corpus::kMagic || corpus::Get(data_ + 4, 2) != corpus::kVersion) {
+      return false;
+    }
+
+    uint64_t numPuzzles = corpus::Get(data_ + 8, 4);
+    uint64_t indexOffset = corpus::Get(data_ + 16, 8);
+    if (numPuzzles > static_cast<uint64_t>(INT_MAX) || indexOffset < corpus::kHeaderSize ||
+        indexOffset > size_ || (size_ - indexOffset) / corpus::kIndexRecordSize < numPuzzles) {
+      return false;
+    }
+    index_ = data_ + indexOffset;
+    numPuzzles_ = static_cast<int>(numPuzzles);
+    return true;
+  }
+
+  const uint8_t* data_;
+  std::size_t size_;
+  int numPuzzles_;
+  const uint8_t* index_;
+};
+
+} // namespace kakuro
+
+#endif
@@ -0,0 +1,177 @@
+#include "corpus.h"
+
+#include <gtest/gtest.h>
+
+#include "board_generator.h"
+#include "constrained_board.h"
+#include "sum_generator.h"
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace kakuro;
+
+namespace {
+Board GeneratePuzzle(unsigned seed, int rows, int columns) {
+  std::mt19937 random;
+  random.seed(seed);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  Board board = boardGenerator.Generate(rows, columns);
+  ConstrainedBoard constrainedBoard{board};
+  SumGenerator sumGenerator{/* verboseLogs */ false};
+  EXPECT_TRUE(sumGenerator.GenerateSums(constrainedBoard));
+  return board;
+}
+
+void ExpectSameBoard(const Board& board, const Board& expected, bool withNumbers) {
+  ASSERT_EQ(board.Rows(), expected.Rows());
+  ASSERT_EQ(board.Columns(), expected.Columns());
+  for (int i = 0; i < board.Rows() * board.Columns(); i++) {
+    const Cell& cell = board[i];
+    const Cell& expectedCell = expected[i];
+    ASSERT_EQ(cell.isBlock, expectedCell.isBlock);
+    ASSERT_EQ(cell.rowBlockSize, expectedCell.rowBlockSize);
+    ASSERT_EQ(cell.columnBlockSize, expectedCell.columnBlockSize);
+    if (cell.isBlock) {
+      ASSERT_EQ(cell.rowBlockSum, expectedCell.rowBlockSum);
+      ASSERT_EQ(cell.columnBlockSum, expectedCell.columnBlockSum);
+    } else {
+      ASSERT_EQ(cell.number, withNumbers ? expectedCell.number : 0);
+    }
+  }
+}
+} // namespace
+
+TEST(CorpusTest, WriteAndRead) {
+  Board first = GeneratePuzzle(/* seed */ 3, 6, 7);
+  Board second = GeneratePuzzle(/* seed */ 5, 5, 5);
+
+  std::string filename = testing::TempDir() + "corpus_test.kkc";
+  {
+    std::ofstream output{filename, std::ios::out | std::ios::binary};
+    CorpusWriter writer{output};
+    writer.Add(first, /* seed */ 3);
+    writer.Add(second, /* seed */ 5, /* withSolution */ false);
+    ASSERT_TRUE(writer.Finish());
+  }
+
+  CorpusReader reader;
+  ASSERT_TRUE(reader.Open(filename));
+  ASSERT_EQ(reader.Size(), 2);
+
+  ASSERT_TRUE(reader[0]);
+  PuzzleView firstView = *reader[0];
+  ASSERT_EQ(firstView.Rows(), 6);
+  ASSERT_EQ(firstView.Columns(), 7);
+  ASSERT_EQ(firstView.Seed(), 3);
+  ASSERT_TRUE(firstView.HasSolution());
+  for (int row = 0; row < first.Rows(); row++) {
+    for (int column = 0; column < first.Columns(); column++) {
+      const Cell& cell = first(row, column);
+      ASSERT_EQ(firstView.IsBlock(row, column), cell.isBlock);
+      if (cell.isBlock) {
+        ASSERT_EQ(firstView.RowBlockSum(row, column), cell.rowBlockSum);
+        ASSERT_EQ(firstView.ColumnBlockSum(row, column), cell.columnBlockSum);
+      } else {
+        ASSERT_EQ(firstView.Number(row, column), cell.number);
+      }
+    }
+  }
+  auto firstBoard = firstView.ToBoard(/* withSolution */ true);
+  ASSERT_TRUE(firstBoard);
+  ExpectSameBoard(*firstBoard, first, /* withNumbers */ true);
+  auto firstPuzzle = firstView.ToBoard();
+  ASSERT_TRUE(firstPuzzle);
+  ExpectSameBoard(*firstPuzzle, first, /* withNumbers */ false);
+
+  ASSERT_TRUE(reader[1]);
+  PuzzleView secondView = *reader[1];
+  ASSERT_EQ(secondView.Seed(), 5);
+  ASSERT_FALSE(secondView.HasSolution());
+  auto secondBoard = secondView.ToBoard(/* withSolution */ true);
+  ASSERT_TRUE(secondBoard);
+  ExpectSameBoard(*secondBoard, second, /* withNumbers */ false);
+}
+
+TEST(CorpusTest, ToBoardCorrupt) {
+  Board board = GeneratePuzzle(/* seed */ 3, 6, 7);
+  std::ostringstream output;
+  CorpusWriter writer{output};
+  writer.Add(board);
+  ASSERT_TRUE(writer.Finish());
+  std::string data = output.str();
+
+  // The puzzle data starts right after the header, with the grid followed by the solution.
+  auto toBoard = [&data](std::size_t offset, uint8_t value, bool withSolution) {
+    std::string modified = data;
+    modified[offset] = static_cast<char>(value);
+    const auto* puzzleData = reinterpret_cast<const uint8_t*>(modified.data()) +
+        corpus::kHeaderSize;
+    return PuzzleView{puzzleData, 6, 7, 3, /* hasSolution */ true}.ToBoard(withSolution);
+  };
+  std::size_t gridOffset = corpus::kHeaderSize;
+  std::size_t solutionOffset = gridOffset + corpus::GridSize(6, 7);
+  ASSERT_TRUE(toBoard(gridOffset, corpus::kBlockBit | 45, /* withSolution */ true));
+  ASSERT_FALSE(toBoard(gridOffset, corpus::kBlockBit | 46, /* withSolution */ false));
+  ASSERT_FALSE(toBoard(gridOffset + 1, 200, /* withSolution */ false));
+
+  // The cell at (1, 1) is free, with its number in the low half of the solution's fifth byte.
+  ASSERT_FALSE(board(1, 1).isBlock);
+  ASSERT_FALSE(toBoard(solutionOffset + 4, 0x0f, /* withSolution */ true));
+  ASSERT_TRUE(toBoard(solutionOffset + 4, 0x0f, /* withSolution */ false));
+
+  // A row of ten free cells is longer than any sum can cover.
+  for (int columns : {10, 11}) {
+    std::ostringstream rowOutput;
+    CorpusWriter rowWriter{rowOutput};
+    rowWriter.Add(Board{2, columns});
+    ASSERT_TRUE(rowWriter.Finish());
+    std::string rowData = rowOutput.str();
+    const auto* puzzleData = reinterpret_cast<const uint8_t*>(rowData.data()) + corpus::kHeaderSize;
+    PuzzleView rowView{puzzleData, 2, columns, 0, /* hasSolution */ true};
+    ASSERT_EQ(rowView.ToBoard().has_value(), columns == 10) << columns;
+  }
+}
+
+TEST(CorpusTest, OpenInvalid) {
+  CorpusReader reader;
+  ASSERT_FALSE(reader.Open(testing::TempDir() + "corpus_test_missing.kkc"));
+
+  std::string filename = testing::TempDir() + "corpus_test_invalid.kkc";
+  {
+    std::ofstream output{filename, std::ios::out | std::ios::binary};
+    CorpusWriter writer{output};
+    writer.Add(Board{4, 4});
+    ASSERT_TRUE(writer.Finish());
+  }
+  ASSERT_TRUE(reader.Open(filename));
+
+  std::string data;
+  {
+    std::ifstream input{filename, std::ios::in | std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{});
+  }
+
+  // Records are only checked on lookup, so a puzzle with zero rows still opens but can't be viewed.
+  {
+    std::string modified = data;
+    std::size_t indexOffset = corpus::Get(
+        reinterpret_cast<const uint8_t*>(modified.data()) + 16, /* numBytes */ 8);
+    modified[indexOffset + 8] = 0;
+    modified[indexOffset + 9] = 0;
+    std::ofstream output{filename, std::ios::out | std::ios::binary | std::ios::trunc};
+    output.write(modified.data(), modified.size());
+  }
+  ASSERT_TRUE(reader.Open(filename));
+  ASSERT_EQ(reader.Size(), 1);
+  ASSERT_FALSE(reader[0]);
+
+  // Cut off the index table, which must be detected rather than read out of bounds.
+  {
+    std::ofstream output{filename, std::ios::out | std::ios::binary | std::ios::trunc};
+    output.write(data.data(), data.size() - 1);
+  }
+  ASSERT_FALSE(reader.Open(filename));
+  ASSERT_EQ(reader.Size(), 0);
+}
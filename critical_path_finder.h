@@ -1,18 +1,44 @@
 #ifndef CRITICAL_PATH_FINDER_H
 #define CRITICAL_PATH_FINDER_H
 
+#include "board.h"
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 namespace kakuro {
 
+enum class CriticalPathMode {
+  kFloodFill, // flood fills the board from each neighbor on every query
+  kArticulationPoints, // looks up articulation points of the free cells, recomputed lazily
+};
+
+// Decides whether making a free cell a block would cut the free cells of the board apart. Both
+// modes give the same answers, but the articulation point mode needs to be told about every block
+// that is added through BlockAdded.
 class CriticalPathFinder {
 public:
-  CriticalPathFinder(const Board& board)
-      : board_{board}, visited_(static_cast<std::size_t>(board.Rows() * board.Columns())) {}
+  CriticalPathFinder(const Board& board, CriticalPathMode mode = CriticalPathMode::kFloodFill)
+      : board_{board},
+        mode_{mode},
+        visited_(static_cast<std::size_t>(board.Rows() * board.Columns()), 0),
+        visitGeneration_{0},
+        articulationPointsValid_{false},
+        numComponentsValid_{false},
+        numComponents_{0} {}
 
+  // A cell is a critical path if it has free neighbors and the other free cells aren't all
+  // connected without it, either because it is an articulation point or because the free cells
+  // were already split up before.
   bool IsCriticalPath(const Cell& cell) {
     if (cell.isBlock) {
       return false;
     }
 
+    if (mode_ == CriticalPathMode::kArticulationPoints) {
+      return IsArticulationCriticalPath(cell);
+    }
+
     const Cell& topCell = board_(cell.row - 1, cell.column);
     if (!topCell.isBlock) {
       ClearMarked();
@@ -60,41 +86,340 @@ public:
     return false;
   }
 
+  // Updates the articulation points after the given cell was made a block.
+  void BlockAdded(const Cell& cell) {
+    if (mode_ != CriticalPathMode::kArticulationPoints) {
+      return;
+    }
+
+    // Any other cell might have become an articulation point now. If the neighbors of the new block
+    // are still connected without it, the free cells stay connected the same way as before though.
+    // An isolated cell on the other hand takes its whole component with it.
+    articulationPointsValid_ = false;
+    if (!numComponentsValid_) {
+      return;
+    }
+    if (NumFreeNeighbors(cell) == 0) {
+      numComponents_--;
+    } else if (!AreNeighborsLocallyConnected(cell)) {
+      auto isCut = SearchAroundCell(cell);
+      if (!isCut || *isCut) {
+        numComponentsValid_ = false;
+      }
+    }
+  }
+
 private:
-  void ClearMarked() {
-    visited_.clear();
-    visited_.resize(board_.Rows() * board_.Columns(), false);
+  bool IsArticulationCriticalPath(const Cell& cell) {
+    if (NumFreeNeighbors(cell) == 0) {
+      return false;
+    }
+
+    if (numComponentsValid_) {
+      if (numComponents_ > 1) {
+        return true;
+      }
+
+      // Fast path: if all neighbors are connected among the eight cells around this one, they stay
+      // connected without it. This settles most cells of open boards without looking further.
+      if (AreNeighborsLocallyConnected(cell)) {
+        return false;
+      }
+    }
+
+    if (!articulationPointsValid_) {
+      // Recomputing the articulation points after every block would be quadratic in the board
+      // size, so we first try to settle the cell with a search limited to its surroundings.
+      if (numComponentsValid_) {
+        auto isCut = SearchAroundCell(cell);
+        if (isCut) {
+          return *isCut;
+        }
+      }
+      ComputeArticulationPoints();
+    }
+    return numComponents_ > 1 || isArticulationPoint_[board_.Index(cell)];
+  }
+
+  // Searches outwards from the cell's neighbors in lockstep, without passing through the cell.
+  // Returns false as soon as all of the searches meet, or true as soon as any group of them runs
+  // out of cells, which means it is cut off from the others. The work is proportional to the
+  // smaller side of the cut, and we give up with nothing once it exceeds the search limit.
+  std::optional<bool> SearchAroundCell(const Cell& cell) {
+    int numCells = board_.Rows() * board_.Columns();
+    if (searchLabels_.size() != static_cast<std::size_t>(numCells)) {
+      searchLabels_.assign(numCells, SearchLabel{0, 0});
+    }
+    searchGeneration_++;
+    int center = board_.Index(cell);
+    searchLabels_[center] = SearchLabel{searchGeneration_, -1};
+
+    int numLabels = 0;
+    for (int direction = 0; direction < 4; direction++) {
+      int row = cell.row + kNeighborRows[direction];
+      int column = cell.column + kNeighborColumns[direction];
+      if (IsFreeAt(row, column)) {
+        int neighbor = row * board_.Columns() + column;
+        searchLabels_[neighbor] = SearchLabel{searchGeneration_, numLabels};
+        searchQueues_[numLabels].clear();
+        searchQueues_[numLabels].push_back(neighbor);
+        searchQueueHeads_[numLabels] = 0;
+        labelGroups_[numLabels] = numLabels;
+        numLabels++;
+      }
+    }
+
+    int numGroups = numLabels;
+    int maxSteps = kSearchLimitFactor * (board_.Rows() + board_.Columns());
+    for (int steps = 0; steps < maxSteps;) {
+      for (int label = 0; label < numLabels; label++) {
+        auto& queue = searchQueues_[label];
+        auto& head = searchQueueHeads_[label];
+        if (head == queue.size()) {
+          continue;
+        }
+
+        const Cell& current = board_[queue[head++]];
+        steps++;
+        for (int direction = 0; direction < 4; direction++) {
+          int row = current.row + kNeighborRows[direction];
+          int column = current.column + kNeighborColumns[direction];
+          if (!IsFreeAt(row, column)) {
+            continue;
+          }
+
+          int neighbor = row * board_.Columns() + column;
+          SearchLabel& neighborLabel = searchLabels_[neighbor];
+          if (neighborLabel.generation != searchGeneration_) {
+            neighborLabel = SearchLabel{searchGeneration_, label};
+            queue.push_back(neighbor);
+          } else if (neighborLabel.label >= 0) {
+            int group = FindLabelGroup(label);
+            int otherGroup = FindLabelGroup(neighborLabel.label);
+            if (group != otherGroup) {
+              labelGroups_[otherGroup] = group;
+              numGroups--;
+              if (numGroups == 1) {
+                return false;
+              }
+            }
+          }
+        }
+      }
+
+      // A group whose searches all ran dry is enclosed without the cell.
+      bool groupActive[4] = {false, false, false, false};
+      for (int label = 0; label < numLabels; label++) {
+        if (searchQueueHeads_[label] < searchQueues_[label].size()) {
+          groupActive[FindLabelGroup(label)] = true;
+        }
+      }
+      for (int label = 0; label < numLabels; label++) {
+        if (FindLabelGroup(label) == label && !groupActive[label]) {
+          return true;
+        }
+      }
+    }
+    return std::nullopt;
+  }
+
+  int FindLabelGroup(int label) const {
+    while (labelGroups_[label] != label) {
+      label = labelGroups_[label];
+    }
+    return label;
+  }
+
+  bool IsFreeAt(int row, int column) const {
+    return row >= 0 && column >= 0 && row < board_.Rows() && column < board_.Columns() &&
+        !board_(row, column).isBlock;
   }
 
-  void Mark(const Cell& cell) { visited_[cell.row * board_.Columns() + cell.column] = true; }
+  int NumFreeNeighbors(const Cell& cell) const {
+    int numFreeNeighbors = 0;
+    for (int direction = 0; direction < 4; direction++) {
+      numFreeNeighbors +=
+          IsFreeAt(cell.row + kNeighborRows[direction], cell.column + kNeighborColumns[direction]);
+    }
+    return numFreeNeighbors;
+  }
+
+  // Returns whether all free neighbors of the cell are connected through the eight cells around it.
+  // Walking around the ring, consecutive cells are neighbors of each other, so this is the case if
+  // all free neighbors are part of the same run of free ring cells.
+  bool AreNeighborsLocallyConnected(const Cell& cell) const {
+    // Clockwise starting at the top, with the direct neighbors at even positions.
+    static constexpr int kRingRows[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    static constexpr int kRingColumns[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+    bool isFree[8];
+    int firstBlock = -1;
+    for (int i = 0; i < 8; i++) {
+      isFree[i] = IsFreeAt(cell.row + kRingRows[i], cell.column + kRingColumns[i]);
+      if (!isFree[i] && firstBlock < 0) {
+        firstBlock = i;
+      }
+    }
+    if (firstBlock < 0) {
+      return true; // the whole ring is free
+    }
+
+    // Count the runs of free cells that contain a direct neighbor, starting after a block so that
+    // no run wraps around.
+    int numNeighborRuns = 0;
+    bool runHasNeighbor = false;
+    for (int j = 1; j <= 8; j++) {
+      int i = (firstBlock + j) % 8;
+      if (isFree[i]) {
+        runHasNeighbor = runHasNeighbor || i % 2 == 0;
+      } else {
+        numNeighborRuns += runHasNeighbor;
+        runHasNeighbor = false;
+      }
+    }
+    return numNeighborRuns <= 1;
+  }
+
+  // Finds the articulation points and connected components of the free cells with an iterative
+  // version of Tarjan's depth first search, so that large open boards can't overflow the stack.
+  void ComputeArticulationPoints() {
+    int numCells = board_.Rows() * board_.Columns();
+    discovery_.assign(numCells, 0);
+    low_.resize(numCells);
+    isArticulationPoint_.assign(numCells, false);
+    numComponents_ = 0;
+
+    int time = 0;
+    for (int root = 0; root < numCells; root++) {
+      if (board_[root].isBlock || discovery_[root] != 0) {
+        continue;
+      }
+
+      numComponents_++;
+      int numRootChildren = 0;
+      discovery_[root] = low_[root] = ++time;
+      searchStack_.push_back(SearchFrame{root, -1, 0});
+      while (!searchStack_.empty()) {
+        SearchFrame& frame = searchStack_.back();
+        if (frame.direction == 4) {
+          // All neighbors are done, so propagate the low value to the parent.
+          int index = frame.index;
+          int parent = frame.parent;
+          searchStack_.pop_back();
+          if (parent >= 0) {
+            low_[parent] = std::min(low_[parent], low_[index]);
+            if (parent != root && low_[index] >= discovery_[parent]) {
+              isArticulationPoint_[parent] = true;
+            }
+          }
+          continue;
+        }
+
+        const Cell& cell = board_[frame.index];
+        int direction = frame.direction++;
+        int row = cell.row + kNeighborRows[direction];
+        int column = cell.column + kNeighborColumns[direction];
+        if (!IsFreeAt(row, column)) {
+          continue;
+        }
+
+        int neighbor = row * board_.Columns() + column;
+        if (discovery_[neighbor] == 0) {
+          if (frame.index == root) {
+            numRootChildren++;
+          }
+          discovery_[neighbor] = low_[neighbor] = ++time;
+          // Careful, this may invalidate our frame reference.
+          searchStack_.push_back(SearchFrame{neighbor, frame.index, 0});
+        } else if (neighbor != frame.parent) {
+          low_[frame.index] = std::min(low_[frame.index], discovery_[neighbor]);
+        }
+      }
 
-  bool IsMarked(const Cell& cell) const {
-    return visited_[cell.row * board_.Columns() + cell.column];
+      // The root of the search is an articulation point if it has more than one subtree.
+      isArticulationPoint_[root] = numRootChildren > 1;
+    }
+
+    articulationPointsValid_ = true;
+    numComponentsValid_ = true;
   }
 
+  // Visited cells are stamped with the current generation, so clearing them just starts a new one.
+  void ClearMarked() { visitGeneration_++; }
+
+  void Mark(const Cell& cell) { visited_[board_.Index(cell)] = visitGeneration_; }
+
+  bool IsMarked(const Cell& cell) const { return visited_[board_.Index(cell)] == visitGeneration_; }
+
+  // Flood fills from the cell with an explicit worklist instead of recursion, so that large open
+  // boards can't overflow the stack.
   int CountReachableCells(const Cell& cell) {
     if (cell.isBlock || IsMarked(cell)) {
       return 0;
     }
 
-    int numReachableUnmarked = 1;
+    int numReachableUnmarked = 0;
     Mark(cell);
+    worklist_.clear();
+    worklist_.push_back(&cell);
+    while (!worklist_.empty()) {
+      const Cell& current = *worklist_.back();
+      worklist_.pop_back();
+      numReachableUnmarked++;
 
-    numReachableUnmarked += CountReachableCells(board_(cell.row - 1, cell.column));
-    numReachableUnmarked += CountReachableCells(board_(cell.row, cell.column - 1));
+      for (int direction = 0; direction < 4; direction++) {
+        int row = current.row + kNeighborRows[direction];
+        int column = current.column + kNeighborColumns[direction];
+        if (!IsFreeAt(row, column)) {
+          continue;
+        }
 
-    if (cell.row + 1 < board_.Rows()) {
-      numReachableUnmarked += CountReachableCells(board_(cell.row + 1, cell.column));
-    }
-    if (cell.column + 1 < board_.Columns()) {
-      numReachableUnmarked += CountReachableCells(board_(cell.row, cell.column + 1));
+        const Cell& neighbor = board_(row, column);
+        if (!IsMarked(neighbor)) {
+          Mark(neighbor);
+          worklist_.push_back(&neighbor);
+        }
+      }
     }
 
     return numReachableUnmarked;
   }
 
+  struct SearchFrame {
+    int index;
+    int parent;
+    int direction; // the next neighbor to visit
+  };
+
+  static constexpr int kNeighborRows[4] = {-1, 0, 1, 0};
+  static constexpr int kNeighborColumns[4] = {0, 1, 0, -1};
+
   const Board& board_;
-  std::vector<bool> visited_;
+  CriticalPathMode mode_;
+  std::vector<int> visited_; // generation in which each cell was last marked
+  int visitGeneration_;
+  std::vector<const Cell*> worklist_;
+
+  // Only used with kArticulationPoints.
+  bool articulationPointsValid_;
+  bool numComponentsValid_;
+  int numComponents_;
+  std::vector<int> discovery_; // zero if not discovered yet
+  std::vector<int> low_;
+  std::vector<bool> isArticulationPoint_;
+  std::vector<SearchFrame> searchStack_;
+
+  // Only used by SearchAroundCell, with labels stamped by generation so they never need clearing.
+  struct SearchLabel {
+    int generation;
+    int label; // index of the neighbor the search started from, -1 for the center cell
+  };
+  static constexpr int kSearchLimitFactor = 4;
+  int searchGeneration_ = 0;
+  std::vector<SearchLabel> searchLabels_;
+  std::vector<int> searchQueues_[4];
+  std::size_t searchQueueHeads_[4];
+  int labelGroups_[4];
 };
 
 } // namespace kakuro
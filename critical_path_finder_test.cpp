@@ -0,0 +1,98 @@
+#include "critical_path_finder.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "board_generator.h"
+#include <random>
+
+using namespace kakuro;
+
+namespace {
+void AssertSameBlocks(const Board& a, const Board& b) {
+  ASSERT_EQ(a.Rows(), b.Rows());
+  ASSERT_EQ(a.Columns(), b.Columns());
+  for (int i = 0; i < a.Rows() * a.Columns(); i++) {
+    ASSERT_EQ(a[i].isBlock, b[i].isBlock) << "at cell (" << a[i].row << ", " << a[i].column << ")";
+  }
+}
+} // namespace
+
+// Test board:
+//   *****
+//   *  **
+//   ** **
+//   *   *
+//
+// The cells (2, 2) and (3, 2) connect the two free cells in the first row with the rest, so they
+// are critical paths. The other cells aren't.
+TEST(CriticalPathFinderTest, Bridge) {
+  Board board{4, 5};
+  board.MakeBlock(board(1, 3));
+  board.MakeBlock(board(1, 4));
+  board.MakeBlock(board(2, 1));
+  board.MakeBlock(board(2, 3));
+  board.MakeBlock(board(2, 4));
+  board.MakeBlock(board(3, 4));
+
+  for (auto mode : {CriticalPathMode::kFloodFill, CriticalPathMode::kArticulationPoints}) {
+    CriticalPathFinder criticalPathFinder{board, mode};
+    ASSERT_FALSE(criticalPathFinder.IsCriticalPath(board(1, 1)));
+    ASSERT_TRUE(criticalPathFinder.IsCriticalPath(board(1, 2)));
+    ASSERT_TRUE(criticalPathFinder.IsCriticalPath(board(2, 2)));
+    ASSERT_TRUE(criticalPathFinder.IsCriticalPath(board(3, 2)));
+    ASSERT_FALSE(criticalPathFinder.IsCriticalPath(board(3, 1)));
+    ASSERT_FALSE(criticalPathFinder.IsCriticalPath(board(3, 3)));
+  }
+}
+
+TEST(CriticalPathFinderTest, ModesAgreeOnEveryCell) {
+  std::mt19937 random;
+  random.seed(7);
+  std::bernoulli_distribution blockDistribution{0.25};
+
+  Board board{12, 12};
+  CriticalPathFinder floodFillFinder{board, CriticalPathMode::kFloodFill};
+  CriticalPathFinder articulationFinder{board, CriticalPathMode::kArticulationPoints};
+  for (int row = 1; row < board.Rows(); row++) {
+    for (int column = 1; column < board.Columns(); column++) {
+      for (int i = 0; i < board.Rows() * board.Columns(); i++) {
+        ASSERT_EQ(
+            articulationFinder.IsCriticalPath(board[i]), floodFillFinder.IsCriticalPath(board[i]))
+            << "at cell (" << board[i].row << ", " << board[i].column << ")";
+      }
+
+      // Make blocks without regard for critical paths, so that the board also splits up.
+      if (blockDistribution(random)) {
+        board.MakeBlock(board(row, column));
+        articulationFinder.BlockAdded(board(row, column));
+      }
+    }
+  }
+}
+
+TEST(CriticalPathFinderTest, GeneratesSameBoards) {
+  for (int seed = 0; seed < 5; seed++) {
+    std::mt19937 floodFillRandom;
+    floodFillRandom.seed(seed);
+    BoardGenerator floodFillGenerator{
+        floodFillRandom, /* blockProbability */ 0.3, CriticalPathMode::kFloodFill};
+
+    std::mt19937 articulationRandom;
+    articulationRandom.seed(seed);
+    BoardGenerator articulationGenerator{
+        articulationRandom, /* blockProbability */ 0.3, CriticalPathMode::kArticulationPoints};
+
+    AssertSameBlocks(
+        floodFillGenerator.Generate(/* rows */ 20, /* columns */ 30),
+        articulationGenerator.Generate(/* rows */ 20, /* columns */ 30));
+  }
+}
+
+TEST(CriticalPathFinderTest, FloodFillLargeOpenBoard) {
+  // Flood filling this board would overflow the stack if it recursed once per cell.
+  Board board{600, 600};
+  CriticalPathFinder criticalPathFinder{board, CriticalPathMode::kFloodFill};
+  ASSERT_FALSE(criticalPathFinder.IsCriticalPath(board(300, 300)));
+  ASSERT_FALSE(criticalPathFinder.IsCriticalPath(board(1, 1)));
+}
@@ -0,0 +1,50 @@
+#include "dump_sink.h"
+#include <fstream>
+#include <iostream>
+
+using namespace kakuro;
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    std::cout << "Usage: kakuro_dump2html [snapshot stream file] [output prefix]" << std::endl;
+    std::cout << "Example: kakuro_dump2html dumps.bin dumps/" << std::endl;
+    std::cout << "Renders every snapshot of a stream written by SnapshotStreamDumpSink into an HTML"
+              << " file named after the output prefix, the snapshot prefix and its index."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string inputFilename{argv[1]};
+  std::string outputPrefix{argc > 2 ? argv[2] : ""};
+
+  std::ifstream inputFile{inputFilename, std::ios::binary};
+  if (!inputFile) {
+    std::cout << "Failed to open snapshot stream file" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numSnapshots = 0;
+  DumpSnapshot snapshot;
+  while (ReadDumpSnapshot(inputFile, snapshot)) {
+    std::string outputFilename =
+        outputPrefix + snapshot.prefix + std::to_string(snapshot.index) + ".html";
+    std::ofstream outputFile{outputFilename};
+    if (!outputFile) {
+      std::cout << "Failed to open output file " << outputFilename << std::endl;
+      return EXIT_FAILURE;
+    }
+    snapshot.RenderHtml(outputFile);
+    numSnapshots++;
+  }
+
+  // A clean end of the stream only sets eofbit, while a malformed or truncated snapshot also sets
+  // failbit.
+  if (!inputFile.eof() || inputFile.fail()) {
+    std::cout << "Stopped at malformed or truncated snapshot after " << numSnapshots
+              << " snapshots." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Rendered " << numSnapshots << " snapshots." << std::endl;
+  return EXIT_SUCCESS;
+}
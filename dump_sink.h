@@ -0,0 +1,262 @@
+#ifndef DUMP_SINK_H
+#define DUMP_SINK_H
+
+#include "board.h"
+#include "board_renderer.h"
+#include "constrained_board.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace kakuro {
+
+// Receives snapshots of a board at interesting points of a search, e.g. whenever the solver reaches
+// a new maximum depth. Each event is identified by a prefix and an index.
+class DumpSink {
+public:
+  virtual ~DumpSink() = default;
+  virtual void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) = 0;
+};
+
+class NullDumpSink : public DumpSink {
+public:
+  void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) override {}
+};
+
+// Renders every event to its own HTML file named after the prefix and index.
+class HtmlDumpSink : public DumpSink {
+public:
+  void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) override {
+    board.Dump(prefix, index);
+  }
+};
+
+inline NullDumpSink& DefaultNullDumpSink() {
+  static NullDumpSink sink;
+  return sink;
+}
+
+inline HtmlDumpSink& DefaultHtmlDumpSink() {
+  static HtmlDumpSink sink;
+  return sink;
+}
+
+// Only forwards the first few events and every so many after that to another sink. Zero disables
+// either rule.
+class SampledDumpSink : public DumpSink {
+public:
+  SampledDumpSink(DumpSink& sink, int every, int first = 0)
+      : sink_{sink}, every_{every}, first_{first}, numEvents_{0} {}
+
+  void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) override {
+    long long event = numEvents_++;
+    if (event < first_ || (every_ > 0 && event % every_ == 0)) {
+      sink_.Dump(board, prefix, index);
+    }
+  }
+
+private:
+  DumpSink& sink_;
+  int every_;
+  int first_;
+  long long numEvents_;
+};
+
+// The state of a single cell in a snapshot.
+struct DumpSnapshotCell {
+  bool isBlock;
+  int number;
+  int rowBlockSum;
+  int columnBlockSum;
+  Numbers numberCandidates;
+  int triviality; // kNotTrivial if not trivial
+};
+
+struct DumpSnapshot {
+  std::string prefix;
+  int index;
+  int rows;
+  int columns;
+  std::vector<DumpSnapshotCell> cells; // row by row
+
+  // Rebuilds the board of the snapshot and renders it like ConstrainedBoard::Dump.
+  void RenderHtml(std::ostream& output) const {
+    std::vector<bool> isBlock(cells.size());
+    std::vector<uint8_t> columnBlockSums(cells.size());
+    std::vector<uint8_t> rowBlockSums(cells.size());
+    std::vector<uint8_t> numbers(cells.size());
+    for (std::size_t i = 0; i < cells.size(); i++) {
+      isBlock[i] = cells[i].isBlock;
+      columnBlockSums[i] = cells[i].isBlock ? cells[i].columnBlockSum : 0;
+      rowBlockSums[i] = cells[i].isBlock ? cells[i].rowBlockSum : 0;
+      numbers[i] = cells[i].isBlock ? 0 : cells[i].number;
+    }
+    Board board =
+        Board::FromBlockMask(rows, columns, isBlock, columnBlockSums, rowBlockSums, numbers);
+
+    BoardRenderer renderer;
+    renderer.Render(board, [this, &board](std::string& output, const Cell& cell) {
+      const auto& snapshotCell = cells[board.Index(cell)];
+      ConstrainedBoard::PrintCellState(
+          output, snapshotCell.number, snapshotCell.numberCandidates, snapshotCell.triviality);
+    });
+    renderer.WriteTo(output);
+  }
+};
+
+// Appends every event as a binary snapshot record to a single stream, which is much cheaper than
+// rendering a file per event. The records can be read back with ReadDumpSnapshot and rendered
+// offline, e.g. with kakuro_dump2html. All values are stored little endian:
+//
+//   uint32 magic, uint16 prefix length, prefix, int32 index, uint16 rows, uint16 columns,
+//   then per cell: uint8 isBlock, int8 number, uint8 row block sum, uint8 column block sum,
+//   uint16 number candidates, int8 triviality, uint8 padding
+class SnapshotStreamDumpSink : public DumpSink {
+public:
+  static constexpr uint32_t kMagic = 0x4b44534e; // "KDSN"
+
+  SnapshotStreamDumpSink(std::ostream& output) : output_{output} {}
+
+  void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) override {
+    const Board& underlyingBoard = board.UnderlyingBoard();
+    int numCells = underlyingBoard.Rows() * underlyingBoard.Columns();
+
+    buffer_.clear();
+    buffer_.reserve(16 + prefix.size() + 8 * numCells);
+    Put(kMagic, 4);
+    Put(prefix.size(), 2);
+    buffer_.insert(buffer_.end(), prefix.begin(), prefix.end());
+    Put(index, 4);
+    Put(underlyingBoard.Rows(), 2);
+    Put(underlyingBoard.Columns(), 2);
+    for (int i = 0; i < numCells; i++) {
+      const Cell& cell = underlyingBoard[i];
+      Put(cell.isBlock, 1);
+      Put(cell.number, 1);
+      Put(cell.isBlock ? cell.rowBlockSum : 0, 1);
+      Put(cell.isBlock ? cell.columnBlockSum : 0, 1);
+      Put(cell.isBlock ? 0 : board.Constraints(cell).numberCandidates.Bits(), 2);
+      Put(board.Triviality(cell).value_or(kNotTrivial), 1);
+      Put(0, 1);
+    }
+    output_.write(buffer_.data(), buffer_.size());
+  }
+
+private:
+  void Put(uint32_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+      buffer_.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+  }
+
+  std::ostream& output_;
+  std::vector<char> buffer_;
+};
+
+// Reads the next record written by SnapshotStreamDumpSink. Returns false at the end of the stream
+// or if the record is malformed or truncated. Like the stream operators, this only sets eofbit at a
+// clean end of the stream, but also sets failbit for a malformed or truncated record.
+inline bool ReadDumpSnapshot(std::istream& input, DumpSnapshot& snapshot) {
+  constexpr std::size_t kBytesPerCell = 8;
+
+  auto malformed = [&input]() {
+    input.setstate(std::ios::failbit);
+    return false;
+  };
+
+  auto get = [&input](int numBytes, bool isSigned = false) -> std::optional<int> {
+    unsigned char bytes[4];
+    if (!input.read(reinterpret_cast<char*>(bytes), numBytes)) {
+      return std::nullopt;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < numBytes; i++) {
+      value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+    }
+    if (isSigned && numBytes < 4 && (value & (1u << (8 * numBytes - 1)))) {
+      value |= ~0u << (8 * numBytes); // sign extend
+    }
+    return static_cast<int>(value);
+  };
+
+  if (input.peek() == std::istream::traits_type::eof()) {
+    return false;
+  }
+
+  auto magic = get(4);
+  if (!magic || static_cast<uint32_t>(*magic) != SnapshotStreamDumpSink::kMagic) {
+    return malformed();
+  }
+
+  auto prefixLength = get(2);
+  if (!prefixLength) {
+    return false;
+  }
+  snapshot.prefix.resize(*prefixLength);
+  if (!input.read(snapshot.prefix.data(), *prefixLength)) {
+    return false;
+  }
+
+  auto index = get(4, /* isSigned */ true);
+  auto rows = get(2);
+  auto columns = get(2);
+  if (!index || !rows || !columns) {
+    return false;
+  }
+  if (*rows < 1 || *rows > INT16_MAX || *columns < 1 || *columns > INT16_MAX) {
+    return malformed();
+  }
+  snapshot.index = *index;
+  snapshot.rows = *rows;
+  snapshot.columns = *columns;
+
+  // Check the size against the rest of the stream if it can tell, so that a corrupt size doesn't
+  // allocate gigabytes. Otherwise, the cells only grow as far as they can actually be read.
+  std::size_t numCells = static_cast<std::size_t>(*rows) * *columns;
+  snapshot.cells.clear();
+  auto position = input.tellg();
+  if (position != std::streampos{-1}) {
+    input.seekg(0, std::ios::end);
+    auto end = input.tellg();
+    input.seekg(position);
+    if (end == std::streampos{-1} || !input) {
+      return malformed();
+    }
+    if (static_cast<std::size_t>(end - position) < kBytesPerCell * numCells) {
+      return malformed();
+    }
+    snapshot.cells.reserve(numCells);
+  }
+
+  for (std::size_t i = 0; i < numCells; i++) {
+    auto isBlock = get(1);
+    auto number = get(1, /* isSigned */ true);
+    auto rowBlockSum = get(1);
+    auto columnBlockSum = get(1);
+    auto numberCandidates = get(2);
+    auto triviality = get(1, /* isSigned */ true);
+    auto padding = get(1);
+    if (!isBlock || !number || !rowBlockSum || !columnBlockSum || !numberCandidates ||
+        !triviality || !padding) {
+      return false;
+    }
+    if (*number < 0 || *number > 9 || *rowBlockSum > 45 || *columnBlockSum > 45 ||
+        *numberCandidates >= 512) {
+      return malformed();
+    }
+    DumpSnapshotCell& cell = snapshot.cells.emplace_back();
+    cell.isBlock = *isBlock != 0;
+    cell.number = *number;
+    cell.rowBlockSum = *rowBlockSum;
+    cell.columnBlockSum = *columnBlockSum;
+    cell.numberCandidates = Numbers::FromBits(*numberCandidates);
+    cell.triviality = *triviality;
+  }
+  return true;
+}
+
+} // namespace kakuro
+
+#endif
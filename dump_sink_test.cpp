@@ -0,0 +1,128 @@
+#include "dump_sink.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kakuro;
+using testing::ElementsAre;
+
+namespace {
+class RecordingDumpSink : public DumpSink {
+public:
+  void Dump(const ConstrainedBoard& board, const std::string& prefix, int index) override {
+    indices.push_back(index);
+  }
+
+  std::vector<int> indices;
+};
+} // namespace
+
+TEST(SampledDumpSink, EveryAndFirst) {
+  Board board{3, 3};
+  ConstrainedBoard constrainedBoard{board};
+  RecordingDumpSink recordingSink;
+  SampledDumpSink sampledSink{recordingSink, /* every */ 4, /* first */ 2};
+  for (int i = 0; i < 10; i++) {
+    sampledSink.Dump(constrainedBoard, "test", i);
+  }
+  ASSERT_THAT(recordingSink.indices, ElementsAre(0, 1, 4, 8));
+}
+
+TEST(SnapshotStreamDumpSink, RoundTrip) {
+  Board board{3, 4};
+  board.MakeBlock(board(1, 2));
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 4, sumUndo);
+  FillNumberUndoContext fillUndo;
+  constrainedBoard.FillNumber(board(1, 1), 7, fillUndo);
+
+  std::stringstream stream;
+  SnapshotStreamDumpSink sink{stream};
+  sink.Dump(constrainedBoard, "first", 3);
+  sink.Dump(constrainedBoard, "second", -1);
+
+  DumpSnapshot snapshot;
+  ASSERT_TRUE(ReadDumpSnapshot(stream, snapshot));
+  ASSERT_EQ(snapshot.prefix, "first");
+  ASSERT_EQ(snapshot.index, 3);
+  ASSERT_EQ(snapshot.rows, 3);
+  ASSERT_EQ(snapshot.columns, 4);
+  for (int i = 0; i < 12; i++) {
+    const Cell& cell = board[i];
+    const auto& snapshotCell = snapshot.cells[i];
+    ASSERT_EQ(snapshotCell.isBlock, cell.isBlock);
+    ASSERT_EQ(snapshotCell.number, cell.number);
+    if (cell.isBlock) {
+      ASSERT_EQ(snapshotCell.rowBlockSum, cell.rowBlockSum);
+      ASSERT_EQ(snapshotCell.columnBlockSum, cell.columnBlockSum);
+    } else {
+      ASSERT_EQ(snapshotCell.numberCandidates, constrainedBoard.Constraints(cell).numberCandidates);
+      ASSERT_EQ(snapshotCell.triviality, constrainedBoard.Triviality(cell).value_or(kNotTrivial));
+    }
+  }
+
+  ASSERT_TRUE(ReadDumpSnapshot(stream, snapshot));
+  ASSERT_EQ(snapshot.prefix, "second");
+  ASSERT_EQ(snapshot.index, -1);
+
+  ASSERT_FALSE(ReadDumpSnapshot(stream, snapshot));
+  ASSERT_TRUE(stream.eof());
+  ASSERT_FALSE(stream.fail());
+}
+
+TEST(SnapshotStreamDumpSink, ReadMalformed) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  std::stringstream stream;
+  SnapshotStreamDumpSink sink{stream};
+  sink.Dump(constrainedBoard, "x", 0);
+  std::string record = stream.str();
+
+  // The header takes 15 bytes with this prefix, followed by 8 bytes per cell.
+  constexpr int kHeaderSize = 15;
+  auto readModified = [&record](int offset, char value) {
+    std::string modified = record;
+    modified[offset] = value;
+    std::stringstream input{modified};
+    DumpSnapshot snapshot;
+    bool success = ReadDumpSnapshot(input, snapshot);
+    return !success && input.fail();
+  };
+  EXPECT_TRUE(readModified(0, 'X')); // magic
+  EXPECT_TRUE(readModified(kHeaderSize - 3, '\x7f')); // far more rows than there are cells
+  EXPECT_TRUE(readModified(kHeaderSize + 8 * 5 + 1, 10)); // number
+  EXPECT_TRUE(readModified(kHeaderSize + 2, 46)); // row block sum
+  EXPECT_TRUE(readModified(kHeaderSize + 3, 46)); // column block sum
+  EXPECT_TRUE(readModified(kHeaderSize + 8 * 5 + 5, 2)); // number candidates
+
+  for (std::size_t size : {std::size_t{2}, std::size_t{kHeaderSize}, record.size() - 1}) {
+    std::stringstream input{record.substr(0, size)};
+    DumpSnapshot snapshot;
+    EXPECT_FALSE(ReadDumpSnapshot(input, snapshot)) << size;
+    EXPECT_TRUE(input.fail()) << size;
+  }
+}
+
+TEST(SnapshotStreamDumpSink, RenderHtml) {
+  Board board{3, 4};
+  board.MakeBlock(board(1, 2));
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 24, sumUndo);
+
+  std::stringstream stream;
+  SnapshotStreamDumpSink sink{stream};
+  sink.Dump(constrainedBoard, "render", 0);
+
+  DumpSnapshot snapshot;
+  ASSERT_TRUE(ReadDumpSnapshot(stream, snapshot));
+  std::ostringstream html;
+  snapshot.RenderHtml(html);
+  ASSERT_THAT(html.str(), testing::HasSubstr(">24<"));
+  ASSERT_THAT(html.str(), testing::HasSubstr("7?8?9?"));
+}
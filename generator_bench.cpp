@@ -0,0 +1,48 @@
+#include "board_generator.h"
+
+#include <benchmark/benchmark.h>
+
+#include "board.h"
+#include "constrained_board.h"
+#include "sum_generator.h"
+#include <random>
+
+using namespace kakuro;
+
+namespace {
+
+void BM_GenerateBoard(benchmark::State& state) {
+  for (auto _ : state) {
+    std::mt19937 random;
+    random.seed(3);
+    BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+    Board board = boardGenerator.Generate(state.range(0), state.range(0));
+    benchmark::DoNotOptimize(board.Numbers());
+  }
+}
+BENCHMARK(BM_GenerateBoard)->Arg(10)->Arg(30)->Arg(60)->Unit(benchmark::kMicrosecond);
+
+// Generating sums is exponential in the worst case, so this sticks to sizes that finish within
+// milliseconds for the fixed seeds.
+void BM_GenerateSums(benchmark::State& state) {
+  std::mt19937 random;
+  random.seed(3);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  Board layout = boardGenerator.Generate(state.range(0), state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Board board = layout;
+    ConstrainedBoard constrainedBoard{board};
+    SumGenerator sumGenerator{/* verboseLogs */ false};
+    state.ResumeTiming();
+
+    if (!sumGenerator.GenerateSums(constrainedBoard)) {
+      state.SkipWithError("Failed to generate sums");
+      break;
+    }
+  }
+}
+BENCHMARK(BM_GenerateSums)->Arg(8)->Arg(10)->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -1,6 +1,9 @@
+#include "batch_generator.h"
 #include "board.h"
+#include "board_renderer.h"
 #include "board_generator.h"
 #include "critical_path_finder.h"
+#include "logger.h"
 #include "numbers.h"
 #include "solver.h"
 #include "sum_generator.h"
@@ -9,13 +12,91 @@
 
 using namespace kakuro;
 
+int RunBatch(int argc, char** argv) {
+  if (argc != 9 && argc != 13) {
+    std::cout << "Usage: kakuro batch [count] [min size] [max size] [first seed] [last seed] "
+                 "[block probability] [output file] [layout threads] [sum threads] "
+                 "[verify threads] [serialize threads]"
+              << std::endl;
+    std::cout << "Example: kakuro batch 1000 10 30 0 99999 0.3 corpus.txt 1 8 4 1" << std::endl;
+    std::cout << "Generates puzzles with unique solutions from the given seeds until there are "
+                 "enough, picking rows and columns from the size range."
+              << std::endl;
+    std::cout << "Output files ending in .kkc are written as binary corpus, all others as text."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  BatchOptions options;
+  options.count = std::atoi(argv[2]);
+  options.minSize = std::atoi(argv[3]);
+  options.maxSize = std::atoi(argv[4]);
+  options.firstSeed = std::strtoul(argv[5], nullptr, 10);
+  options.lastSeed = std::strtoul(argv[6], nullptr, 10);
+  options.blockProbability = std::atof(argv[7]);
+  std::string outputFilename{argv[8]};
+  std::string corpusExtension{".kkc"};
+  if (outputFilename.size() >= corpusExtension.size() &&
+      outputFilename.compare(
+          outputFilename.size() - corpusExtension.size(), corpusExtension.size(),
+          corpusExtension) == 0) {
+    options.format = BatchFormat::kCorpus;
+  }
+  if (argc == 13) {
+    options.layoutThreads = std::atoi(argv[9]);
+    options.sumThreads = std::atoi(argv[10]);
+    options.verifyThreads = std::atoi(argv[11]);
+    options.serializeThreads = std::atoi(argv[12]);
+  } else {
+    // Sum generation and verification do most of the work.
+    int numThreads = std::max(1u, std::thread::hardware_concurrency());
+    options.sumThreads = std::max(1, numThreads * 2 / 3);
+    options.verifyThreads = std::max(1, numThreads / 3);
+  }
+
+  Logger logger;
+  if (options.count < 1 || options.minSize < 2 || options.minSize > options.maxSize ||
+      options.firstSeed > options.lastSeed || options.layoutThreads < 1 ||
+      options.sumThreads < 1 || options.verifyThreads < 1 || options.serializeThreads < 1) {
+    logger.Log(LogLevel::kError) << "Invalid batch options";
+    return EXIT_FAILURE;
+  }
+
+  auto mode = options.format == BatchFormat::kCorpus ? std::ios::out | std::ios::binary
+                                                     : std::ios::out;
+  std::ofstream outputFile{outputFilename, mode};
+  if (!outputFile) {
+    logger.Log(LogLevel::kError) << "Failed to open output file";
+    return EXIT_FAILURE;
+  }
+
+  BatchGenerator batchGenerator{options};
+  auto result = batchGenerator.Generate(outputFile);
+  logger.Log(LogLevel::kInfo) << "Wrote " << result.numWritten << " puzzles from "
+                              << result.numSeedsTried << " seeds, " << result.numFailedSums
+                              << " without sums, " << result.numSumsOverBudget
+                              << " over the sum budget and " << result.numNotUnique
+                              << " without unique solution.";
+  return result.numWritten == options.count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char** argv) {
-  if (argc != 5) {
-    std::cout << "Usage: kakuro [rows] [columns] [block probability] [output file]" << std::endl;
+  if (argc > 1 && std::string{argv[1]} == "batch") {
+    return RunBatch(argc, argv);
+  }
+
+  if (argc != 5 && argc != 6) {
+    std::cout << "Usage: kakuro [rows] [columns] [block probability] [output file] [stats file]"
+              << std::endl;
     std::cout << "Example: kakuro 20 32 0.3 kakuro.html" << std::endl;
     std::cout << "Then open the resulting kakuro.html file in your browser." << std::endl;
+    std::cout << "Output files ending in .svg are rendered as an image for printing instead."
+              << std::endl;
     std::cout << "The cells contain the solution as background color, select the text to see it."
               << std::endl;
+    std::cout << "If a stats file is given, solver statistics are written to it as JSON."
+              << std::endl;
+    std::cout << "Run kakuro batch for generating many puzzles at once." << std::endl;
     return EXIT_FAILURE;
   }
 
@@ -23,12 +104,14 @@ int main(int argc, char** argv) {
   int columns = std::atoi(argv[2]);
   double blockProbability = std::atof(argv[3]);
   std::string outputFilename{argv[4]};
+  std::string statsFilename{argc > 5 ? argv[5] : ""};
 
   std::random_device randomDevice;
   std::mt19937 random;
   random.seed(3);
 
-  std::cout << "Generating board..." << std::endl;
+  Logger logger;
+  logger.Log(LogLevel::kInfo) << "Generating board...";
   BoardGenerator boardGenerator{random, blockProbability};
   auto board = boardGenerator.Generate(rows, columns);
   ConstrainedBoard constrainedBoard{board};
@@ -36,25 +119,49 @@ int main(int argc, char** argv) {
   /*
   Solver solver;
   if (!solver.Solve(board)) {
-    std::cout << "Failed to solve board" << std::endl;
+    logger.Log(LogLevel::kError) << "Failed to solve board";
     return EXIT_FAILURE;
   }
   */
 
+  SolverStats stats;
   SumGenerator sumGenerator;
+  sumGenerator.SetStats(&stats);
   if (!sumGenerator.GenerateSums(constrainedBoard)) {
-    std::cout << "Failed to generate sums" << std::endl;
+    logger.Log(LogLevel::kError) << "Failed to generate sums";
     return EXIT_FAILURE;
   }
 
   std::ofstream outputFile{outputFilename};
   if (!outputFile) {
-    std::cout << "Failed to open output file" << std::endl;
+    logger.Log(LogLevel::kError) << "Failed to open output file";
+    return EXIT_FAILURE;
+  }
+
+  // SVG output is for printing, so its cells stay empty.
+  std::string svgExtension{".svg"};
+  bool isSvg = outputFilename.size() >= svgExtension.size() &&
+      outputFilename.compare(
+          outputFilename.size() - svgExtension.size(), svgExtension.size(), svgExtension) == 0;
+  BoardRenderer renderer{isSvg ? RenderFormat::kSvg : RenderFormat::kHtml};
+  renderer.Render(board, [isSvg](std::string& output, const Cell& cell) {
+    if (!isSvg) {
+      output += "<input type=text />";
+    }
+  });
+  if (!renderer.WriteTo(outputFile)) {
+    logger.Log(LogLevel::kError) << "Failed to write output file";
     return EXIT_FAILURE;
   }
 
-  board.RenderHtml(
-      outputFile, [](std::ostream& output, const Cell& cell) { output << "<input type=text />"; });
+  if (!statsFilename.empty()) {
+    std::ofstream statsFile{statsFilename};
+    if (!statsFile) {
+      logger.Log(LogLevel::kError) << "Failed to open stats file";
+      return EXIT_FAILURE;
+    }
+    stats.WriteJson(statsFile);
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,105 @@
+#include "legacy_engine.h"
+
+#include "board_generator.h"
+#include "solver.h"
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+
+using namespace kakuro;
+
+TEST(LegacyEngineTest, GenerateCombinations) {
+  auto combinations = legacy::GenerateCombinations();
+  ASSERT_EQ(combinations[3][2].size(), 1);
+  EXPECT_TRUE(combinations[3][2][0][1]);
+  EXPECT_TRUE(combinations[3][2][0][2]);
+  EXPECT_EQ(combinations[17][2].size(), 1); // 8 + 9
+  EXPECT_EQ(combinations[45][9].size(), 1);
+  EXPECT_EQ(combinations[10][2].size(), 4);
+}
+
+TEST(LegacyEngineTest, LayoutMatchesBoard) {
+  std::mt19937 random;
+  random.seed(5);
+  BoardGenerator boardGenerator{random, 0.3};
+  auto board = boardGenerator.Generate(9, 11);
+
+  legacy::Board legacyBoard{9, 11};
+  for (int row = 1; row < board.Rows(); row++) {
+    for (int column = 1; column < board.Columns(); column++) {
+      if (board(row, column).isBlock) {
+        legacyBoard.MakeBlock(legacyBoard.CellAt(row, column));
+      }
+    }
+  }
+
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      const auto& cell = board(row, column);
+      auto& legacyCell = legacyBoard.CellAt(row, column);
+      ASSERT_EQ(legacyCell.isBlock, cell.isBlock) << row << ", " << column;
+      if (cell.isBlock) {
+        EXPECT_EQ(legacyCell.rowBlockSize, cell.rowBlockSize) << row << ", " << column;
+        EXPECT_EQ(legacyCell.columnBlockSize, cell.columnBlockSize) << row << ", " << column;
+      } else {
+        EXPECT_EQ(legacyCell.RowBlockDistance(), cell.RowBlockDistance()) << row << ", " << column;
+        EXPECT_EQ(legacyCell.ColumnBlockDistance(), cell.ColumnBlockDistance())
+            << row << ", " << column;
+      }
+    }
+  }
+}
+
+TEST(LegacyEngineTest, GenerateSums) {
+  auto combinations = legacy::GenerateCombinations();
+  std::ostringstream log;
+
+  std::mt19937 random;
+  random.seed(3);
+  legacy::Board legacyBoard{5, 5};
+  legacyBoard.SetLog(log);
+  legacy::GenerateLayout(legacyBoard, random, 0.3, log);
+  legacy::GenerateSums(legacyBoard, combinations, random, log);
+  ASSERT_FALSE(legacyBoard.SolveBudgetExceeded());
+
+  // Every chosen sum must be part of a solution, and sums of blocks without one are left open.
+  Board board{5, 5};
+  for (int row = 1; row < board.Rows(); row++) {
+    for (int column = 1; column < board.Columns(); column++) {
+      if (legacyBoard.CellAt(row, column).isBlock) {
+        board.MakeBlock(board(row, column));
+      }
+    }
+  }
+  int numSums = 0;
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      auto& legacyCell = legacyBoard.CellAt(row, column);
+      if (legacyCell.isBlock) {
+        board.SetBlockSum(board(row, column), /* isRow */ true, legacyCell.sumRow);
+        board.SetBlockSum(board(row, column), /* isRow */ false, legacyCell.sumColumn);
+        numSums += (legacyCell.sumRow > 0) + (legacyCell.sumColumn > 0);
+      }
+    }
+  }
+  EXPECT_GT(numSums, 0);
+  EXPECT_FALSE(log.str().empty());
+
+  Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+  EXPECT_TRUE(solver.Solve(board));
+}
+
+TEST(LegacyEngineTest, SolveBudget) {
+  auto combinations = legacy::GenerateCombinations();
+  std::ostringstream log;
+
+  std::mt19937 random;
+  random.seed(3);
+  legacy::Board legacyBoard{8, 8};
+  legacyBoard.SetLog(log);
+  legacyBoard.SetSolveBudget(10);
+  legacy::GenerateLayout(legacyBoard, random, 0.3, log);
+  legacy::GenerateSums(legacyBoard, combinations, random, log);
+  EXPECT_TRUE(legacyBoard.SolveBudgetExceeded());
+}
@@ -0,0 +1,187 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Log levels above this one are compiled out entirely, e.g. define KAKURO_MAX_LOG_LEVEL to 1 to
+// only keep errors and info messages.
+#ifndef KAKURO_MAX_LOG_LEVEL
+#define KAKURO_MAX_LOG_LEVEL 3
+#endif
+
+namespace kakuro {
+
+enum class LogLevel {
+  kError = 0,
+  kInfo = 1, // progress of whole boards and subboards
+  kDebug = 2, // progress within a single search
+  kTrace = 3, // every attempt and backtrack
+};
+
+// Receives complete log lines without trailing newline. Must be safe to call from multiple threads.
+class LogSink {
+public:
+  virtual ~LogSink() = default;
+  virtual void Write(LogLevel level, std::string_view line) = 0;
+  virtual void Flush() {}
+};
+
+class NullLogSink : public LogSink {
+public:
+  void Write(LogLevel level, std::string_view line) override {}
+};
+
+// Collects lines into a buffer that a background thread writes to the output, so that logging never
+// waits for the output and never flushes it per line. The output is only flushed on Flush and when
+// the sink is destroyed.
+class AsyncLogSink : public LogSink {
+public:
+  AsyncLogSink(std::ostream& output, std::size_t bufferSize = 1 << 16)
+      : output_{output}, bufferSize_{bufferSize}, stop_{false}, flushRequested_{false} {
+    buffer_.reserve(bufferSize_);
+    writing_.reserve(bufferSize_);
+    thread_ = std::thread{[this] { Run(); }};
+  }
+
+  AsyncLogSink(const AsyncLogSink&) = delete;
+  AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+  ~AsyncLogSink() override {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  void Write(LogLevel level, std::string_view line) override {
+    bool full;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      buffer_.append(line);
+      buffer_.push_back('\n');
+      full = buffer_.size() >= bufferSize_;
+    }
+    if (full) {
+      wake_.notify_one();
+    }
+  }
+
+  // Blocks until everything written so far has reached the output.
+  void Flush() override {
+    std::unique_lock<std::mutex> lock{mutex_};
+    flushRequested_ = true;
+    wake_.notify_one();
+    flushed_.wait(lock, [this] { return !flushRequested_; });
+  }
+
+private:
+  void Run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+      wake_.wait(lock, [this] {
+        return stop_ || flushRequested_ || buffer_.size() >= bufferSize_;
+      });
+      bool stop = stop_;
+      bool flush = stop_ || flushRequested_;
+
+      // Swap buffers so that others can keep logging while we write.
+      writing_.swap(buffer_);
+      lock.unlock();
+      output_.write(writing_.data(), writing_.size());
+      if (flush) {
+        output_.flush();
+      }
+      writing_.clear();
+      lock.lock();
+
+      if (flush && buffer_.empty()) {
+        flushRequested_ = false;
+        flushed_.notify_all();
+      }
+      if (stop && buffer_.empty()) {
+        return;
+      }
+    }
+  }
+
+  std::ostream& output_;
+  std::size_t bufferSize_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  std::string buffer_;
+  std::string writing_; // only accessed by the background thread
+  bool stop_;
+  bool flushRequested_;
+  std::thread thread_;
+};
+
+// The process-wide sink writing to standard output.
+inline LogSink& DefaultLogSink() {
+  static AsyncLogSink sink{std::cout};
+  return sink;
+}
+
+// Formats a single log line, which is written to the sink once the line goes out of scope.
+class LogLine {
+public:
+  LogLine(LogSink& sink, LogLevel level) : sink_{sink}, level_{level} {}
+  ~LogLine() { sink_.Write(level_, stream_.str()); }
+
+  template <typename T>
+  LogLine& operator<<(const T& value) {
+    stream_ << value;
+    return *this;
+  }
+
+private:
+  LogSink& sink_;
+  LogLevel level_;
+  std::ostringstream stream_;
+};
+
+// A sink together with the maximum level to log. Check Enabled before formatting a line with Log,
+// so that disabled levels cost only that branch:
+//
+//   if (logger_.Enabled(LogLevel::kDebug)) {
+//     logger_.Log(LogLevel::kDebug) << "Solved " << numCells << " cells.";
+//   }
+class Logger {
+public:
+  explicit Logger(LogLevel level = LogLevel::kInfo) : Logger{DefaultLogSink(), level} {}
+  Logger(LogSink& sink, LogLevel level) : sink_{&sink}, level_{level} {}
+
+  // Disabled logger that never formats nor writes anything.
+  static Logger Disabled() {
+    static NullLogSink nullSink;
+    return Logger{nullSink, LogLevel::kError, /* enabled */ false};
+  }
+
+  bool Enabled(LogLevel level) const {
+    return static_cast<int>(level) <= KAKURO_MAX_LOG_LEVEL && enabled_ && level <= level_;
+  }
+
+  LogLine Log(LogLevel level) const { return LogLine{*sink_, level}; }
+
+  void Flush() const { sink_->Flush(); }
+
+private:
+  Logger(LogSink& sink, LogLevel level, bool enabled)
+      : sink_{&sink}, level_{level}, enabled_{enabled} {}
+
+  LogSink* sink_;
+  LogLevel level_;
+  bool enabled_ = true;
+};
+
+} // namespace kakuro
+
+#endif
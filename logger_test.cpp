@@ -0,0 +1,59 @@
+#include "logger.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kakuro;
+using testing::ElementsAre;
+
+namespace {
+class RecordingLogSink : public LogSink {
+public:
+  void Write(LogLevel level, std::string_view line) override { lines.emplace_back(line); }
+
+  std::vector<std::string> lines;
+};
+} // namespace
+
+TEST(Logger, FiltersLevels) {
+  RecordingLogSink sink;
+  Logger logger{sink, LogLevel::kDebug};
+  ASSERT_TRUE(logger.Enabled(LogLevel::kError));
+  ASSERT_TRUE(logger.Enabled(LogLevel::kInfo));
+  ASSERT_TRUE(logger.Enabled(LogLevel::kDebug));
+  ASSERT_FALSE(logger.Enabled(LogLevel::kTrace));
+
+  logger.Log(LogLevel::kInfo) << "Solved " << 42 << " cells.";
+  ASSERT_THAT(sink.lines, ElementsAre("Solved 42 cells."));
+}
+
+TEST(Logger, Disabled) {
+  Logger logger = Logger::Disabled();
+  ASSERT_FALSE(logger.Enabled(LogLevel::kError));
+  ASSERT_FALSE(logger.Enabled(LogLevel::kTrace));
+}
+
+TEST(AsyncLogSink, Flush) {
+  std::ostringstream output;
+  AsyncLogSink sink{output};
+  Logger logger{sink, LogLevel::kInfo};
+  logger.Log(LogLevel::kInfo) << "first";
+  logger.Log(LogLevel::kInfo) << "second";
+  logger.Flush();
+  ASSERT_EQ(output.str(), "first\nsecond\n");
+}
+
+TEST(AsyncLogSink, WritesWhenBufferFull) {
+  std::ostringstream output;
+  {
+    AsyncLogSink sink{output, /* bufferSize */ 8};
+    for (int i = 0; i < 100; i++) {
+      sink.Write(LogLevel::kInfo, "line");
+    }
+  }
+  ASSERT_EQ(output.str().size(), 100 * std::string{"line\n"}.size());
+}
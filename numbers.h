@@ -1,85 +1,110 @@
 #ifndef NUMBERS_H
 #define NUMBERS_H
 
-#include <bitset>
+#include <array>
 #include <cassert>
+#include <cstdint>
 
 namespace kakuro {
 
+// Precomputed properties of every subset of the numbers 1-9, indexed by the subset's bitmask.
+struct NumbersTables {
+  std::array<uint8_t, 512> sum;
+  std::array<uint8_t, 512> min;
+  std::array<uint8_t, 512> max;
+  std::array<uint8_t, 512> count;
+};
+
+constexpr NumbersTables MakeNumbersTables() {
+  NumbersTables tables{};
+  for (int bits = 0; bits < 512; bits++) {
+    for (int number = 1; number <= 9; number++) {
+      if (bits & (1 << (number - 1))) {
+        tables.sum[bits] += number;
+        tables.count[bits]++;
+        if (tables.min[bits] == 0) {
+          tables.min[bits] = number;
+        }
+        tables.max[bits] = number;
+      }
+    }
+  }
+  return tables;
+}
+
+inline constexpr NumbersTables kNumbersTables = MakeNumbersTables();
+
 class Numbers {
 public:
-  Numbers() : bitset_{} {}
+  static constexpr uint16_t kAllBits = 0x1ff;
 
-  void Add(int number) {
+  constexpr Numbers() : bits_{0} {}
+
+  static constexpr Numbers FromBits(uint16_t bits) {
+    assert(bits < 512);
+    Numbers numbers;
+    numbers.bits_ = bits;
+    return numbers;
+  }
+
+  constexpr uint16_t Bits() const { return bits_; }
+
+  constexpr void Add(int number) {
     assert(number > 0);
     assert(number <= 9);
-    bitset_.set(number - 1);
+    bits_ |= Bit(number);
   }
 
-  void Remove(int number) {
+  constexpr void Remove(int number) {
     assert(number > 0);
     assert(number <= 9);
-    bitset_.reset(number - 1);
+    bits_ &= ~Bit(number);
   }
 
-  bool Has(int number) const {
+  constexpr bool Has(int number) const {
     assert(number > 0);
     assert(number <= 9);
-    return bitset_[number - 1];
+    return (bits_ & Bit(number)) != 0;
   }
 
-  int Count() const { return static_cast<int>(bitset_.count()); }
+  // A table lookup beats __builtin_popcount unless the compiler may emit the popcnt instruction.
+  constexpr int Count() const { return kNumbersTables.count[bits_]; }
 
-  int Sum() const {
-    int sum = 0;
-    for (int number = 1; number <= 9; number++) {
-      if (Has(number)) {
-        sum += number;
-      }
-    }
-    return sum;
-  }
+  constexpr int Sum() const { return kNumbersTables.sum[bits_]; }
 
-  int Min() const {
-    for (int number = 1; number <= 9; number++) {
-      if (Has(number)) {
-        return number;
-      }
-    }
-    return 0;
-  }
+  constexpr int Min() const { return kNumbersTables.min[bits_]; }
 
-  int Max() const {
-    for (int number = 9; number >= 1; number--) {
-      if (Has(number)) {
-        return number;
-      }
-    }
-    return 0;
-  }
+  constexpr int Max() const { return kNumbersTables.max[bits_]; }
 
-  void Clear() { bitset_.reset(); }
+  constexpr void Clear() { bits_ = 0; }
 
-  void Fill() { bitset_.set(); }
+  constexpr void Fill() { bits_ = kAllBits; }
 
-  void Or(const Numbers& other) { bitset_ |= other.bitset_; }
-  void And(const Numbers& other) { bitset_ &= other.bitset_; }
-  void Xor(const Numbers& other) { bitset_ ^= other.bitset_; }
+  constexpr void Or(const Numbers& other) { bits_ |= other.bits_; }
+  constexpr void And(const Numbers& other) { bits_ &= other.bits_; }
+  constexpr void Xor(const Numbers& other) { bits_ ^= other.bits_; }
 
-  void ForEachTrue(const std::function<void(int number)>& callback) const {
-    for (int number = 1; number <= 9; number++) {
-      if (Has(number)) {
-        callback(number);
-      }
+  template <typename Callback>
+  void ForEachTrue(Callback&& callback) const {
+    for (unsigned bits = bits_; bits != 0; bits &= bits - 1) {
+      callback(LowestNumber(bits));
     }
   }
 
-  bool operator==(const Numbers& other) const {
-    return bitset_ == other.bitset_;
-  }
+  constexpr bool operator==(const Numbers& other) const { return bits_ == other.bits_; }
 
 private:
-  std::bitset<9> bitset_;
+  static constexpr uint16_t Bit(int number) { return static_cast<uint16_t>(1u << (number - 1)); }
+
+  static int LowestNumber(unsigned bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits) + 1;
+#else
+    return kNumbersTables.min[bits & kAllBits];
+#endif
+  }
+
+  uint16_t bits_;
 };
 
 } // namespace kakuro
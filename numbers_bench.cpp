@@ -0,0 +1,108 @@
+#include "numbers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <bitset>
+#include <vector>
+
+using namespace kakuro;
+
+namespace {
+
+// The std::bitset based implementation Numbers used to have, kept as a baseline.
+class BitsetNumbers {
+public:
+  void Add(int number) { bitset_.set(number - 1); }
+
+  bool Has(int number) const { return bitset_[number - 1]; }
+
+  int Count() const { return static_cast<int>(bitset_.count()); }
+
+  int Sum() const {
+    int sum = 0;
+    for (int number = 1; number <= 9; number++) {
+      if (Has(number)) {
+        sum += number;
+      }
+    }
+    return sum;
+  }
+
+  int Min() const {
+    for (int number = 1; number <= 9; number++) {
+      if (Has(number)) {
+        return number;
+      }
+    }
+    return 0;
+  }
+
+  int Max() const {
+    for (int number = 9; number >= 1; number--) {
+      if (Has(number)) {
+        return number;
+      }
+    }
+    return 0;
+  }
+
+private:
+  std::bitset<9> bitset_;
+};
+
+template <typename NumbersType>
+std::vector<NumbersType> AllSubsets() {
+  std::vector<NumbersType> subsets(512);
+  for (int bits = 0; bits < 512; bits++) {
+    for (int number = 1; number <= 9; number++) {
+      if (bits & (1 << (number - 1))) {
+        subsets[bits].Add(number);
+      }
+    }
+  }
+  return subsets;
+}
+
+template <typename NumbersType>
+void BM_NumbersSum(benchmark::State& state) {
+  auto subsets = AllSubsets<NumbersType>();
+  for (auto _ : state) {
+    int total = 0;
+    for (const auto& numbers : subsets) {
+      total += numbers.Sum();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+}
+BENCHMARK_TEMPLATE(BM_NumbersSum, Numbers);
+BENCHMARK_TEMPLATE(BM_NumbersSum, BitsetNumbers);
+
+template <typename NumbersType>
+void BM_NumbersMinMax(benchmark::State& state) {
+  auto subsets = AllSubsets<NumbersType>();
+  for (auto _ : state) {
+    int total = 0;
+    for (const auto& numbers : subsets) {
+      total += numbers.Min() + numbers.Max();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+}
+BENCHMARK_TEMPLATE(BM_NumbersMinMax, Numbers);
+BENCHMARK_TEMPLATE(BM_NumbersMinMax, BitsetNumbers);
+
+template <typename NumbersType>
+void BM_NumbersCount(benchmark::State& state) {
+  auto subsets = AllSubsets<NumbersType>();
+  for (auto _ : state) {
+    int total = 0;
+    for (const auto& numbers : subsets) {
+      total += numbers.Count();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+}
+BENCHMARK_TEMPLATE(BM_NumbersCount, Numbers);
+BENCHMARK_TEMPLATE(BM_NumbersCount, BitsetNumbers);
+
+} // namespace
@@ -0,0 +1,347 @@
+#ifndef PARALLEL_SOLVER_H
+#define PARALLEL_SOLVER_H
+
+#include "board.h"
+#include "constrained_board.h"
+#include "logger.h"
+#include "solver.h"
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kakuro {
+
+// Solves subboards by splitting the top levels of the search tree into tasks, which are then
+// processed by a pool of worker threads that steal tasks from each other once they run dry. Each
+// worker solves on its own copy of the board, and the first solution found cancels all others.
+class ParallelSolver {
+public:
+  ParallelSolver(int numThreads = 0, int tasksPerThread = 8, bool verboseLogs = true)
+      : numThreads_{numThreads > 0 ? numThreads : DefaultNumThreads()},
+        tasksPerThread_{tasksPerThread},
+        logger_{verboseLogs ? Logger{LogLevel::kInfo} : Logger::Disabled()},
+        solver_{/* solveTrivial */ true, /* verboseLogs */ false} {}
+
+  int NumThreads() const { return numThreads_; }
+
+  void SetLogger(Logger logger) { logger_ = logger; }
+
+  bool Solve(Board& board) {
+    ConstrainedBoard constrainedBoard{board};
+    auto solution = Solve(constrainedBoard);
+    return !solution.empty();
+  }
+
+  std::vector<FillNumberUndoContext> Solve(ConstrainedBoard& board) {
+    std::vector<FillNumberUndoContext> solution;
+
+    auto trivialSolution = solver_.SolveTrivialCells(board);
+    if (!trivialSolution) {
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Board starting with invalid trivial solution.";
+      }
+      return {};
+    }
+    solution.insert(solution.end(), trivialSolution->begin(), trivialSolution->end());
+
+    // Need to solve free cells in a loop because there could be multiple separate regions.
+    while (true) {
+      auto freeCells = board.UnderlyingBoard().FindFreeCells();
+      if (freeCells.empty()) {
+        return solution;
+      }
+
+      const auto& cell = **freeCells.begin();
+      auto subboard = board.UnderlyingBoard().FindSubboard(cell);
+
+      // Sort cells by number of sum constraints so we solve those with existing constraints first.
+      std::sort(subboard.begin(), subboard.end(), [&](const Cell* a, const Cell* b) {
+        int numSumsA = (board.UnderlyingBoard().RowBlock(*a).rowBlockSum > 0) +
+            (board.UnderlyingBoard().ColumnBlock(*a).columnBlockSum > 0);
+        int numSumsB = (board.UnderlyingBoard().RowBlock(*b).rowBlockSum > 0) +
+            (board.UnderlyingBoard().ColumnBlock(*b).columnBlockSum > 0);
+        return numSumsA > numSumsB;
+      });
+
+      auto subboardSolution = SolveCells(board, subboard);
+      if (subboardSolution.empty()) {
+        if (logger_.Enabled(LogLevel::kInfo)) {
+          logger_.Log(LogLevel::kInfo) << "Failed to solve subboard of size " << subboard.size()
+                                       << " using " << numThreads_ << " threads.";
+        }
+        solver_.UndoSolution(board, solution);
+        return {};
+      }
+
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Solved subboard of size " << subboard.size() << " using "
+                                     << numThreads_ << " threads.";
+      }
+      solution.insert(solution.end(), subboardSolution.begin(), subboardSolution.end());
+    }
+  }
+
+  // Same contract as Solver::SolveCells: returns the fills that solve the given cells, which are
+  // applied to the passed board, or an empty list if there is no solution. A task that fails to
+  // replay is an internal error, which asserts and also returns an empty list.
+  std::vector<FillNumberUndoContext> SolveCells(
+      ConstrainedBoard& board, const std::vector<const Cell*>& cells) {
+    cells_.clear();
+    for (const Cell* cell : cells) {
+      cells_.push_back(board.UnderlyingBoard().Index(*cell));
+    }
+    tasks_.clear();
+    combinationPropagation_ = board.CombinationPropagation();
+    solved_ = false;
+    cancel_ = false;
+    failed_ = false;
+    winningFills_.clear();
+
+    // Split the top levels of the search tree breadth first until there is enough work to go
+    // around. Levels where only a single candidate survives don't add any tasks, so the depth is
+    // capped to keep narrow trees from being searched here on the caller's thread.
+    int targetNumTasks = numThreads_ * tasksPerThread_;
+    int maxSplitDepth = kExtraSplitDepth;
+    for (int numTasks = 1; numTasks < targetNumTasks; numTasks *= 2) {
+      maxSplitDepth++;
+    }
+
+    if (FirstFreeCell(board.UnderlyingBoard()) == static_cast<int>(cells_.size())) {
+      solved_ = true;
+    } else {
+      tasks_.emplace_back();
+    }
+    for (int splitDepth = 0; splitDepth < maxSplitDepth && !solved_ && !tasks_.empty() &&
+         static_cast<int>(tasks_.size()) < targetNumTasks;
+         splitDepth++) {
+      if (!SplitTasks(board)) {
+        failed_ = true;
+        break;
+      }
+    }
+
+    if (!solved_ && !failed_ && !tasks_.empty()) {
+      RunWorkers(board.UnderlyingBoard());
+    }
+
+    // Tasks are split from the caller's board and the workers start from a copy of it, so replaying
+    // them can only fail if there is a bug, which must not be mistaken for an unsolvable board.
+    std::vector<FillNumberUndoContext> solution;
+    if (failed_ || (solved_ && !Replay(board, winningFills_, solution))) {
+      if (logger_.Enabled(LogLevel::kError)) {
+        logger_.Log(LogLevel::kError) << "Failed to replay a task of a parallel solve.";
+      }
+      assert(false && "parallel solver task failed to replay");
+      return {};
+    }
+    return solution;
+  }
+
+private:
+  // Number of split levels beyond log2 of the target number of tasks, for levels that don't branch.
+  static constexpr int kExtraSplitDepth = 4;
+
+  struct Fill {
+    int cellIndex;
+    int number;
+  };
+
+  using Task = std::vector<Fill>;
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+  };
+
+  static int DefaultNumThreads() {
+    int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    return numThreads > 0 ? numThreads : 1;
+  }
+
+  static void AppendFills(
+      const Board& board, const std::vector<FillNumberUndoContext>& fills, Task& task) {
+    for (const auto& fill : fills) {
+      task.push_back(Fill{board.Index(*fill.cell), fill.cell->number});
+    }
+  }
+
+  // Returns the position of the first free cell in cells_, or its size if all of them are filled.
+  int FirstFreeCell(const Board& board) const {
+    int position = 0;
+    while (position < static_cast<int>(cells_.size()) && !board[cells_[position]].IsFree()) {
+      position++;
+    }
+    return position;
+  }
+
+  // Splits the search tree one level deeper by replacing every task with one task per candidate of
+  // its first free cell, each including whatever becomes trivial along the way. Returns false if a
+  // task can't be replayed.
+  bool SplitTasks(ConstrainedBoard& board) {
+    const Board& underlyingBoard = board.UnderlyingBoard();
+    std::vector<Task> frontier;
+    for (const Task& task : tasks_) {
+      std::vector<FillNumberUndoContext> replay;
+      if (!Replay(board, task, replay)) {
+        return false;
+      }
+
+      int cellIndex = cells_[FirstFreeCell(underlyingBoard)];
+      const Cell& cell = underlyingBoard[cellIndex];
+      for (int number = 1; number <= 9 && !solved_; number++) {
+        if (!board.Constraints(cell).numberCandidates.Has(number)) {
+          continue;
+        }
+
+        FillNumberUndoContext undo;
+        if (!board.FillNumber(cell, number, undo)) {
+          continue;
+        }
+
+        auto trivialSolution = solver_.SolveTrivialCells(board);
+        if (trivialSolution) {
+          Task split = task;
+          split.push_back(Fill{cellIndex, number});
+          AppendFills(underlyingBoard, *trivialSolution, split);
+          if (FirstFreeCell(underlyingBoard) == static_cast<int>(cells_.size())) {
+            // The task already fills every cell, so we don't need the workers at all.
+            solved_ = true;
+            winningFills_ = std::move(split);
+          } else {
+            frontier.push_back(std::move(split));
+          }
+          solver_.UndoSolution(board, *trivialSolution);
+        }
+        board.UndoFillNumber(undo);
+      }
+
+      solver_.UndoSolution(board, replay);
+      if (solved_) {
+        break;
+      }
+    }
+
+    tasks_ = std::move(frontier);
+    return true;
+  }
+
+  void RunWorkers(const Board& board) {
+    int numWorkers = std::min(numThreads_, static_cast<int>(tasks_.size()));
+    std::vector<WorkerQueue> queues(numWorkers);
+    for (int i = 0; i < static_cast<int>(tasks_.size()); i++) {
+      queues[i % numWorkers].tasks.push_back(i);
+    }
+
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < numWorkers; worker++) {
+      workers.emplace_back([this, &board, &queues, worker] { RunWorker(board, queues, worker); });
+    }
+    for (auto& thread : workers) {
+      thread.join();
+    }
+  }
+
+  // Applies the fills of a task to a board. If any of them can't be applied, the board is left as
+  // it was and false is returned.
+  static bool Replay(
+      ConstrainedBoard& board, const Task& task, std::vector<FillNumberUndoContext>& replay) {
+    const Board& underlyingBoard = board.UnderlyingBoard();
+    for (const Fill& fill : task) {
+      FillNumberUndoContext undo;
+      if (!board.FillNumber(underlyingBoard[fill.cellIndex], fill.number, undo)) {
+        for (auto iter = replay.rbegin(); iter != replay.rend(); ++iter) {
+          board.UndoFillNumber(*iter);
+        }
+        replay.clear();
+        return false;
+      }
+      replay.emplace_back(undo);
+    }
+    return true;
+  }
+
+  // Pops tasks from the back of the worker's own queue and steals from the front of the others.
+  static bool NextTask(std::vector<WorkerQueue>& queues, int worker, int& task) {
+    {
+      std::lock_guard<std::mutex> lock{queues[worker].mutex};
+      if (!queues[worker].tasks.empty()) {
+        task = queues[worker].tasks.back();
+        queues[worker].tasks.pop_back();
+        return true;
+      }
+    }
+
+    for (std::size_t i = 1; i < queues.size(); i++) {
+      auto& victim = queues[(worker + i) % queues.size()];
+      std::lock_guard<std::mutex> lock{victim.mutex};
+      if (!victim.tasks.empty()) {
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void RunWorker(const Board& sharedBoard, std::vector<WorkerQueue>& queues, int worker) {
+    Board board{sharedBoard};
+    ConstrainedBoard constrainedBoard{board, combinationPropagation_};
+    std::vector<const Cell*> cells;
+    for (int cellIndex : cells_) {
+      cells.push_back(&board[cellIndex]);
+    }
+
+    Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+    solver.SetCancellationFlag(&cancel_);
+
+    int taskIndex;
+    while (!cancel_.load(std::memory_order_relaxed) && NextTask(queues, worker, taskIndex)) {
+      const Task& task = tasks_[taskIndex];
+
+      // Dropping a task that fails to replay would lose part of the search space, so the whole
+      // solve is failed instead.
+      std::vector<FillNumberUndoContext> replay;
+      if (!Replay(constrainedBoard, task, replay)) {
+        failed_ = true;
+        cancel_ = true;
+        return;
+      }
+
+      auto solution = solver.SolveCells(constrainedBoard, cells);
+      if (!solution.empty()) {
+        std::lock_guard<std::mutex> lock{winnerMutex_};
+        if (!solved_) {
+          solved_ = true;
+          winningFills_ = task;
+          AppendFills(board, solution, winningFills_);
+          cancel_ = true;
+        }
+        return;
+      }
+
+      solver.UndoSolution(constrainedBoard, replay);
+    }
+  }
+
+  int numThreads_;
+  int tasksPerThread_;
+  Logger logger_;
+  Solver solver_;
+  std::vector<int> cells_;
+  std::vector<Task> tasks_;
+  bool combinationPropagation_;
+  std::atomic<bool> cancel_;
+  std::mutex winnerMutex_; // guards winningFills_ while workers run
+  std::atomic<bool> solved_;
+  std::atomic<bool> failed_;
+  Task winningFills_;
+};
+
+} // namespace kakuro
+
+#endif
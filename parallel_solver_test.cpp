@@ -0,0 +1,116 @@
+#include "parallel_solver.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "board.h"
+#include "board_generator.h"
+
+using namespace kakuro;
+using testing::IsEmpty;
+using testing::Not;
+
+// Parameterized by number of threads.
+class ParallelSolverTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(ParallelSolverTest, SolveEmpty) {
+  Board board{3, 4};
+  ParallelSolver solver{GetParam()};
+  bool solved = solver.Solve(board);
+  ASSERT_TRUE(solved);
+
+  for (int row = 1; row <= 2; row++) {
+    for (int col = 1; col <= 3; col++) {
+      ASSERT_NE(board(row, col).number, 0) << "field must be solved";
+    }
+  }
+}
+
+TEST_P(ParallelSolverTest, SolveUnique) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 7, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 24, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 10, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 13, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 8, sumUndo);
+  ParallelSolver solver{GetParam()};
+  auto result = solver.Solve(constrainedBoard);
+  ASSERT_THAT(result, Not(IsEmpty()));
+
+  ASSERT_EQ(board(1, 1).number, 2);
+  ASSERT_EQ(board(1, 2).number, 4);
+  ASSERT_EQ(board(1, 3).number, 1);
+  ASSERT_EQ(board(2, 1).number, 8);
+  ASSERT_EQ(board(2, 2).number, 9);
+  ASSERT_EQ(board(2, 3).number, 7);
+}
+
+TEST_P(ParallelSolverTest, SolveImpossible) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 5, sumUndo);
+  ParallelSolver solver{GetParam()};
+  auto result = solver.Solve(constrainedBoard);
+  ASSERT_THAT(result, IsEmpty());
+}
+
+TEST_P(ParallelSolverTest, SolveGenerated) {
+  std::mt19937 random;
+  random.seed(3);
+
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  auto board = boardGenerator.Generate(/* rows */ 10, /* columns */ 20);
+
+  ParallelSolver solver{GetParam()};
+  bool solved = solver.Solve(board);
+  ASSERT_TRUE(solved);
+
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      const Cell& cell = board(row, column);
+      ASSERT_TRUE(cell.isBlock || cell.IsFilled());
+      if (cell.isBlock) {
+        continue;
+      }
+
+      // Make sure no number repeats within the cell's blocks.
+      for (bool isRow : {true, false}) {
+        board.ForEachBlockCell(
+            isRow ? board.RowBlock(cell) : board.ColumnBlock(cell),
+            isRow,
+            [&cell](const Cell& currentCell) {
+              if (&currentCell != &cell) {
+                ASSERT_NE(currentCell.number, cell.number);
+              }
+            });
+      }
+    }
+  }
+}
+
+TEST_P(ParallelSolverTest, SolveMoreTasksThanSplitDepth) {
+  std::mt19937 random;
+  random.seed(3);
+
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  auto board = boardGenerator.Generate(/* rows */ 10, /* columns */ 20);
+
+  // Asks for far more tasks than the capped split depth can produce, so the workers get whatever
+  // frontier there is.
+  ParallelSolver solver{GetParam(), /* tasksPerThread */ 256, /* verboseLogs */ false};
+  ASSERT_TRUE(solver.Solve(board));
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      ASSERT_TRUE(board(row, column).isBlock || board(row, column).IsFilled());
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(NumThreads, ParallelSolverTest, testing::Values(1, 4));
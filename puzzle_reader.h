@@ -0,0 +1,474 @@
+#ifndef PUZZLE_READER_H
+#define PUZZLE_READER_H
+
+#include "board.h"
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace kakuro {
+
+enum class PuzzleFormat {
+  kText, // the text format of WritePuzzleText
+  kJson,
+};
+
+// Reads puzzles one at a time from a stream, so that collections of millions of puzzles never have
+// to be held in memory at once. Boards come with their blocks and sums, and with the numbers of any
+// filled cells, and are ready to be wrapped in a ConstrainedBoard.
+//
+// The JSON format is either a single array of puzzles or a sequence of puzzles separated by
+// whitespace, such as one puzzle per line. Each puzzle is an object with the rows of its cells,
+// where a block cell is an array of its column block sum and row block sum, and a free cell is its
+// number or zero if it is empty:
+//
+//   {"rows": 3, "columns": 4, "cells": [
+//     [[0, 0], [4, 0], [3, 0], [5, 0]],
+//     [[0, 6], 1, 2, 3],
+//     [[0, 6], 0, 0, 0]]}
+//
+// The "rows" and "columns" members are optional and checked against the cells if they are given,
+// and any other members are ignored.
+class PuzzleReader {
+public:
+  PuzzleReader(std::istream& input, PuzzleFormat format = PuzzleFormat::kText)
+      : input_{*input.rdbuf()},
+        format_{format},
+        line_{1},
+        inArray_{false},
+        numInArray_{0},
+        rows_{0},
+        columns_{0} {}
+
+  // Returns the next puzzle, or nothing at the end of the input or if the puzzle is malformed, in
+  // which case Error describes why.
+  std::optional<Board> Next() {
+    if (!error_.empty()) {
+      return std::nullopt;
+    }
+
+    bool hasPuzzle = format_ == PuzzleFormat::kText ? ReadTextPuzzle() : ReadJsonPuzzle();
+    if (!hasPuzzle) {
+      return std::nullopt;
+    }
+    return BuildBoard();
+  }
+
+  // Returns an empty string unless reading failed.
+  const std::string& Error() const { return error_; }
+
+private:
+  static constexpr int kEnd = std::streambuf::traits_type::eof();
+  static constexpr int kMaxInteger = 1000000;
+
+  int Peek() { return input_.sgetc(); }
+
+  int Get() {
+    int c = input_.sbumpc();
+    if (c == '\n') {
+      line_++;
+    }
+    return c;
+  }
+
+  bool Fail(const std::string& message) {
+    error_ = "line " + std::to_string(line_) + ": " + message;
+    return false;
+  }
+
+  bool Expect(char expected) {
+    if (Peek() != expected) {
+      return Fail(std::string{"expected '"} + expected + "'");
+    }
+    Get();
+    return true;
+  }
+
+  // Skips spaces within a line.
+  void SkipSpaces() {
+    while (Peek() == ' ' || Peek() == '\t' || Peek() == '\r') {
+      Get();
+    }
+  }
+
+  void SkipWhitespace() {
+    while (Peek() == ' ' || Peek() == '\t' || Peek() == '\r' || Peek() == '\n') {
+      Get();
+    }
+  }
+
+  bool ReadInteger(int& value) {
+    if (Peek() < '0' || Peek() > '9') {
+      return Fail("expected a number");
+    }
+    value = 0;
+    while (Peek() >= '0' && Peek() <= '9') {
+      value = 10 * value + (Get() - '0');
+      if (value > kMaxInteger) {
+        return Fail("number too large");
+      }
+    }
+    return true;
+  }
+
+  void StartGrid() {
+    rows_ = 0;
+    columns_ = 0;
+    isBlock_.clear();
+    columnSums_.clear();
+    rowSums_.clear();
+    numbers_.clear();
+  }
+
+  bool AddBlockCell(int columnSum, int rowSum) {
+    if (columnSum > 45 || rowSum > 45) {
+      return Fail("block sum too large");
+    }
+    isBlock_.push_back(true);
+    columnSums_.push_back(columnSum);
+    rowSums_.push_back(rowSum);
+    numbers_.push_back(0);
+    return true;
+  }
+
+  bool AddFreeCell(int row, int column, int number) {
+    if (row == 0 || column == 0) {
+      return Fail("free cell in the first row or column");
+    }
+    if (number > 9) {
+      return Fail("number too large");
+    }
+    isBlock_.push_back(false);
+    columnSums_.push_back(0);
+    rowSums_.push_back(0);
+    numbers_.push_back(number);
+    return true;
+  }
+
+  bool CheckSize(int rows, int columns) {
+    if (rows < 1 || rows > INT16_MAX || columns < 1 || columns > INT16_MAX) {
+      return Fail("invalid board size");
+    }
+    return true;
+  }
+
+  // Reads a header line like "kakuro 3 4", followed by a line of cells per row.
+  bool ReadTextPuzzle() {
+    SkipWhitespace();
+    if (Peek() == kEnd) {
+      return false;
+    }
+
+    for (char expected : std::string{"kakuro"}) {
+      if (!Expect(expected)) {
+        return false;
+      }
+    }
+    int rows;
+    int columns;
+    SkipSpaces();
+    if (!ReadInteger(rows)) {
+      return false;
+    }
+    SkipSpaces();
+    if (!ReadInteger(columns) || !ReadTextLineEnd() || !CheckSize(rows, columns)) {
+      return false;
+    }
+
+    StartGrid();
+    for (int row = 0; row < rows; row++) {
+      for (int column = 0; column < columns; column++) {
+        SkipSpaces();
+        if (!ReadTextCell(row, column)) {
+          return false;
+        }
+      }
+      if (!ReadTextLineEnd()) {
+        return false;
+      }
+    }
+    rows_ = rows;
+    columns_ = columns;
+    return true;
+  }
+
+  bool ReadTextLineEnd() {
+    SkipSpaces();
+    int c = Peek();
+    if (c != '\n' && c != kEnd) {
+      return Fail("expected the end of the line");
+    }
+    Get();
+    return true;
+  }
+
+  bool ReadTextCell(int row, int column) {
+    int c = Peek();
+    if (c == '#') {
+      Get();
+      return AddBlockCell(0, 0);
+    } else if (c == '.') {
+      Get();
+      return AddFreeCell(row, column, 0);
+    }
+
+    int value;
+    if (!ReadInteger(value)) {
+      return false;
+    }
+    if (Peek() != '\\') {
+      return AddFreeCell(row, column, value);
+    }
+    Get();
+    int rowSum;
+    return ReadInteger(rowSum) && AddBlockCell(value, rowSum);
+  }
+
+  bool ReadJsonPuzzle() {
+    SkipWhitespace();
+    if (!inArray_ && numInArray_ == 0 && Peek() == '[') {
+      Get();
+      inArray_ = true;
+      SkipWhitespace();
+    }
+
+    if (inArray_) {
+      if (Peek() == ']') {
+        Get();
+        inArray_ = false;
+        numInArray_ = 1; // don't start another array
+        return false;
+      }
+      if (numInArray_ > 0) {
+        if (!Expect(',')) {
+          return false;
+        }
+        SkipWhitespace();
+      }
+      numInArray_++;
+    } else if (Peek() == kEnd) {
+      return false;
+    }
+
+    int rows = -1;
+    int columns = -1;
+    bool hasCells = false;
+    if (!Expect('{')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Peek() != '}') {
+      while (true) {
+        std::string key;
+        SkipWhitespace();
+        if (!ReadJsonString(key)) {
+          return false;
+        }
+        SkipWhitespace();
+        if (!Expect(':')) {
+          return false;
+        }
+        SkipWhitespace();
+
+        bool success;
+        if (key == "rows") {
+          success = ReadInteger(rows);
+        } else if (key == "columns") {
+          success = ReadInteger(columns);
+        } else if (key == "cells") {
+          success = ReadJsonCells();
+          hasCells = true;
+        } else {
+          success = SkipJsonValue();
+        }
+        if (!success) {
+          return false;
+        }
+
+        SkipWhitespace();
+        if (Peek() != ',') {
+          break;
+        }
+        Get();
+      }
+    }
+    if (!Expect('}')) {
+      return false;
+    }
+
+    if (!hasCells) {
+      return Fail("puzzle without cells");
+    }
+    if ((rows >= 0 && rows != rows_) || (columns >= 0 && columns != columns_)) {
+      return Fail("board size doesn't match the cells");
+    }
+    return true;
+  }
+
+  // Reads the rows of cells, keeping track of the board size.
+  bool ReadJsonCells() {
+    StartGrid();
+    if (!Expect('[')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Peek() == ']') {
+      return Fail("board without rows");
+    }
+
+    for (int row = 0;; row++) {
+      SkipWhitespace();
+      if (!Expect('[')) {
+        return false;
+      }
+      int column = 0;
+      for (;; column++) {
+        SkipWhitespace();
+        if (!ReadJsonCell(row, column)) {
+          return false;
+        }
+        SkipWhitespace();
+        if (Peek() != ',') {
+          break;
+        }
+        Get();
+      }
+      if (!Expect(']')) {
+        return false;
+      }
+
+      if (row == 0) {
+        columns_ = column + 1;
+      } else if (column + 1 != columns_) {
+        return Fail("rows have different numbers of cells");
+      }
+      rows_ = row + 1;
+
+      SkipWhitespace();
+      if (Peek() != ',') {
+        break;
+      }
+      Get();
+    }
+    return Expect(']') && CheckSize(rows_, columns_);
+  }
+
+  bool ReadJsonCell(int row, int column) {
+    if (Peek() != '[') {
+      int number;
+      return ReadInteger(number) && AddFreeCell(row, column, number);
+    }
+
+    Get();
+    int columnSum;
+    int rowSum;
+    SkipWhitespace();
+    if (!ReadInteger(columnSum)) {
+      return false;
+    }
+    SkipWhitespace();
+    if (!Expect(',')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (!ReadInteger(rowSum)) {
+      return false;
+    }
+    SkipWhitespace();
+    return Expect(']') && AddBlockCell(columnSum, rowSum);
+  }
+
+  bool ReadJsonString(std::string& value) {
+    if (!Expect('"')) {
+      return false;
+    }
+    value.clear();
+    while (Peek() != '"') {
+      int c = Get();
+      if (c == kEnd || c == '\n') {
+        return Fail("unterminated string");
+      }
+      if (c == '\\') {
+        c = Get(); // escapes don't matter for the member names we look for
+      }
+      value.push_back(static_cast<char>(c));
+    }
+    Get();
+    return true;
+  }
+
+  // Skips over a value of a member we don't know, including any nested objects and arrays.
+  bool SkipJsonValue() {
+    int depth = 0;
+    std::string ignored;
+    do {
+      SkipWhitespace();
+      int c = Peek();
+      if (c == kEnd) {
+        return Fail("unexpected end of input");
+      } else if (c == '"') {
+        if (!ReadJsonString(ignored)) {
+          return false;
+        }
+      } else if (c == '{' || c == '[') {
+        Get();
+        depth++;
+      } else if (c == '}' || c == ']') {
+        if (depth == 0) {
+          return Fail("unexpected end of value");
+        }
+        Get();
+        depth--;
+      } else if (c == ',' || c == ':') {
+        if (depth == 0) {
+          return Fail("unexpected separator");
+        }
+        Get();
+      } else {
+        // numbers, true, false and null
+        while (Peek() != kEnd && Peek() != ',' && Peek() != ':' && Peek() != '}' &&
+               Peek() != ']' && Peek() != ' ' && Peek() != '\t' && Peek() != '\r' &&
+               Peek() != '\n') {
+          Get();
+        }
+      }
+    } while (depth > 0);
+    return true;
+  }
+
+  // Builds the board of the puzzle, which fails if any block is longer than the nine cells a sum
+  // can cover, since ConstrainedBoard has no combinations for those.
+  std::optional<Board> BuildBoard() {
+    auto board = Board::FromBlockMask(rows_, columns_, isBlock_, columnSums_, rowSums_, numbers_);
+    int numCells = rows_ * columns_;
+    for (int i = 0; i < numCells; i++) {
+      if (board[i].rowBlockSize > 9 || board[i].columnBlockSize > 9) {
+        Fail("block too long");
+        return std::nullopt;
+      }
+    }
+    return board;
+  }
+
+  std::streambuf& input_;
+  PuzzleFormat format_;
+  int line_;
+  std::string error_;
+  bool inArray_;
+  int numInArray_;
+
+  // The cells of the puzzle being read, reused between puzzles.
+  int rows_;
+  int columns_;
+  std::vector<bool> isBlock_;
+  std::vector<uint8_t> columnSums_;
+  std::vector<uint8_t> rowSums_;
+  std::vector<uint8_t> numbers_;
+};
+
+} // namespace kakuro
+
+#endif
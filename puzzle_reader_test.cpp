@@ -0,0 +1,158 @@
+#include "puzzle_reader.h"
+
+#include <gtest/gtest.h>
+
+#include "board_generator.h"
+#include "constrained_board.h"
+#include "puzzle_text.h"
+#include "solver.h"
+#include "sum_generator.h"
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace kakuro;
+
+namespace {
+void ExpectSameBoard(const Board& board, const Board& expected) {
+  ASSERT_EQ(board.Rows(), expected.Rows());
+  ASSERT_EQ(board.Columns(), expected.Columns());
+  ASSERT_EQ(board.Numbers(), expected.Numbers());
+  for (int i = 0; i < board.Rows() * board.Columns(); i++) {
+    const Cell& cell = board[i];
+    const Cell& expectedCell = expected[i];
+    ASSERT_EQ(cell.isBlock, expectedCell.isBlock);
+    ASSERT_EQ(cell.number, expectedCell.number);
+    ASSERT_EQ(cell.rowBlockSize, expectedCell.rowBlockSize);
+    ASSERT_EQ(cell.columnBlockSize, expectedCell.columnBlockSize);
+    ASSERT_EQ(cell.rowBlockFree, expectedCell.rowBlockFree);
+    ASSERT_EQ(cell.columnBlockFree, expectedCell.columnBlockFree);
+    ASSERT_EQ(&board.RowBlock(cell) - &board[0], &expected.RowBlock(expectedCell) - &expected[0]);
+    ASSERT_EQ(
+        &board.ColumnBlock(cell) - &board[0], &expected.ColumnBlock(expectedCell) - &expected[0]);
+    if (cell.isBlock) {
+      ASSERT_EQ(cell.rowBlockSum, expectedCell.rowBlockSum);
+      ASSERT_EQ(cell.columnBlockSum, expectedCell.columnBlockSum);
+    }
+  }
+}
+} // namespace
+
+TEST(PuzzleReaderTest, ReadText) {
+  std::vector<Board> boards;
+  for (unsigned seed : {1, 2, 3}) {
+    std::mt19937 random;
+    random.seed(seed);
+    BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+    boards.push_back(boardGenerator.Generate(7, 9));
+    ConstrainedBoard constrainedBoard{boards.back()};
+    SumGenerator sumGenerator{/* verboseLogs */ false};
+    ASSERT_TRUE(sumGenerator.GenerateSums(constrainedBoard));
+  }
+
+  std::stringstream text;
+  for (const Board& board : boards) {
+    WritePuzzleText(board, text);
+  }
+
+  PuzzleReader reader{text};
+  for (const Board& board : boards) {
+    auto readBoard = reader.Next();
+    ASSERT_TRUE(readBoard) << reader.Error();
+    ExpectSameBoard(*readBoard, board);
+  }
+  ASSERT_FALSE(reader.Next());
+  ASSERT_EQ(reader.Error(), "");
+}
+
+TEST(PuzzleReaderTest, ReadJson) {
+  std::istringstream json{
+      "[{\"rows\": 3, \"columns\": 4, \"name\": {\"a\": [1, \"]\"]}, \"cells\": [\n"
+      "  [[0, 0], [4, 0], [3, 0], [5, 0]],\n"
+      "  [[0, 6], 0, 0, 0],\n"
+      "  [[0, 6], 0, 0, 0]]},\n"
+      " {\"cells\": [[[0, 0], [1, 0]], [[0, 1], 1]]}]\n"};
+  PuzzleReader reader{json, PuzzleFormat::kJson};
+
+  auto board = reader.Next();
+  ASSERT_TRUE(board) << reader.Error();
+  ASSERT_EQ(board->Rows(), 3);
+  ASSERT_EQ(board->Columns(), 4);
+  ASSERT_EQ((*board)(0, 2).columnBlockSum, 3);
+  ASSERT_EQ((*board)(2, 0).rowBlockSum, 6);
+  ASSERT_EQ((*board)(0, 2).columnBlockSize, 2);
+
+  // The puzzle has exactly two solutions.
+  ConstrainedBoard constrainedBoard{*board};
+  Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 3), 2);
+
+  auto filledBoard = reader.Next();
+  ASSERT_TRUE(filledBoard) << reader.Error();
+  ASSERT_EQ((*filledBoard)(1, 1).number, 1);
+  ASSERT_EQ((*filledBoard)(1, 0).rowBlockFree, 0);
+
+  ASSERT_FALSE(reader.Next());
+  ASSERT_EQ(reader.Error(), "");
+}
+
+TEST(PuzzleReaderTest, ReadInvalid) {
+  auto readError = [](const std::string& input, PuzzleFormat format) {
+    std::istringstream stream{input};
+    PuzzleReader reader{stream, format};
+    while (reader.Next()) {
+    }
+    return reader.Error();
+  };
+
+  ASSERT_EQ(readError("kakuro 2 2\n# #\n# 1\n# #\n", PuzzleFormat::kText), "line 4: expected 'k'");
+  ASSERT_EQ(
+      readError("kakuro 2 2\n# 1\n# 1\n", PuzzleFormat::kText),
+      "line 2: free cell in the first row or column");
+  ASSERT_EQ(readError("kakuro 2 2\n# #\n# x\n", PuzzleFormat::kText), "line 3: expected a number");
+  ASSERT_EQ(
+      readError("kakuro 2 2\n# 46\\0\n# .\n", PuzzleFormat::kText), "line 2: block sum too large");
+  ASSERT_EQ(readError("kakuro 0 2\n", PuzzleFormat::kText), "line 2: invalid board size");
+  ASSERT_EQ(
+      readError("{\"cells\": [[[0, 0], [0, 0]], [[0, 0]]]}", PuzzleFormat::kJson),
+      "line 1: rows have different numbers of cells");
+  ASSERT_EQ(
+      readError("{\"rows\": 3, \"cells\": [[[0, 0]]]}", PuzzleFormat::kJson),
+      "line 1: board size doesn't match the cells");
+  ASSERT_EQ(readError("{\"rows\": 1}", PuzzleFormat::kJson), "line 1: puzzle without cells");
+}
+
+TEST(PuzzleReaderTest, ReadBlockTooLong) {
+  auto readRow = [](int numFree) {
+    std::string input = "kakuro 2 " + std::to_string(numFree + 1) + "\n#";
+    for (int i = 0; i < numFree; i++) {
+      input += " #";
+    }
+    input += "\n0\\45";
+    for (int i = 0; i < numFree; i++) {
+      input += " .";
+    }
+    return input + "\n";
+  };
+
+  std::istringstream validStream{readRow(9)};
+  PuzzleReader validReader{validStream};
+  auto validBoard = validReader.Next();
+  ASSERT_TRUE(validBoard);
+  ConstrainedBoard constrainedBoard{*validBoard};
+
+  std::istringstream rowStream{readRow(11)};
+  PuzzleReader rowReader{rowStream};
+  ASSERT_FALSE(rowReader.Next());
+  ASSERT_EQ(rowReader.Error(), "line 4: block too long");
+
+  std::string column = "{\"cells\": [[[0, 0], [0, 0]]";
+  for (int i = 0; i < 10; i++) {
+    column += ", [[0, 0], 0]";
+  }
+  column += "]}";
+  std::istringstream columnStream{column};
+  PuzzleReader columnReader{columnStream, PuzzleFormat::kJson};
+  ASSERT_FALSE(columnReader.Next());
+  ASSERT_EQ(columnReader.Error(), "line 1: block too long");
+}
@@ -0,0 +1,48 @@
+#ifndef PUZZLE_TEXT_H
+#define PUZZLE_TEXT_H
+
+#include "board.h"
+#include <ostream>
+
+namespace kakuro {
+
+// Writes a board in a line-oriented text format, which starts with a header line and is followed by
+// a line per row and an empty line:
+//
+//   kakuro 3 4
+//   # 4\0 3\0 5\0
+//   0\6 1 2 3
+//   0\6 3 1 2
+//
+// Block cells are written as "#" without sums, and otherwise as their column block sum and row
+// block sum separated by a backslash, with zero for a sum that isn't set. Free cells are written as
+// their number, or "." if they are empty or withSolution is false. PuzzleReader reads it back.
+inline void WritePuzzleText(const Board& board, std::ostream& output, bool withSolution = true) {
+  output << "kakuro " << board.Rows() << " " << board.Columns() << "\n";
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      const Cell& cell = board(row, column);
+      if (column > 0) {
+        output << " ";
+      }
+
+      if (cell.isBlock) {
+        if (cell.columnBlockSum == 0 && cell.rowBlockSum == 0) {
+          output << "#";
+          continue;
+        }
+        output << cell.columnBlockSum << "\\" << cell.rowBlockSum;
+      } else if (withSolution && cell.number > 0) {
+        output << static_cast<int>(cell.number);
+      } else {
+        output << ".";
+      }
+    }
+    output << "\n";
+  }
+  output << "\n";
+}
+
+} // namespace kakuro
+
+#endif
@@ -0,0 +1,31 @@
+#include "puzzle_text.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace kakuro;
+
+TEST(PuzzleTextTest, Write) {
+  Board board{3, 4};
+  board.SetBlockSum(board(0, 1), /* isRow */ false, 4);
+  board.SetBlockSum(board(0, 2), /* isRow */ false, 3);
+  board.SetBlockSum(board(0, 3), /* isRow */ false, 5);
+  board.SetBlockSum(board(1, 0), /* isRow */ true, 6);
+  board.SetBlockSum(board(2, 0), /* isRow */ true, 6);
+  int numbers[2][3] = {{1, 2, 3}, {3, 1, 2}};
+  for (int row = 1; row <= 2; row++) {
+    for (int column = 1; column <= 3; column++) {
+      board.SetNumber(board(row, column), numbers[row - 1][column - 1]);
+    }
+  }
+
+  std::ostringstream output;
+  WritePuzzleText(board, output);
+  ASSERT_EQ(output.str(), "kakuro 3 4\n# 4\\0 3\\0 5\\0\n0\\6 1 2 3\n0\\6 3 1 2\n\n");
+
+  std::ostringstream outputWithoutSolution;
+  WritePuzzleText(board, outputWithoutSolution, /* withSolution */ false);
+  ASSERT_EQ(
+      outputWithoutSolution.str(), "kakuro 3 4\n# 4\\0 3\\0 5\\0\n0\\6 . . .\n0\\6 . . .\n\n");
+}
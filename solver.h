@@ -3,7 +3,12 @@
 
 #include "board.h"
 #include "constrained_board.h"
+#include "dump_sink.h"
+#include "logger.h"
+#include "solver_stats.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <optional>
 #include <random>
@@ -11,17 +16,97 @@
 
 namespace kakuro {
 
+enum class SolveStatus { kSolved, kNoSolution, kBudgetExceeded };
+
+// Limits how much work a single Solve, SolveCells or Resume call may do. Zero means unlimited.
+struct SolveBudget {
+  long long maxNodes = 0; // number of search tree nodes to visit
+  std::chrono::milliseconds maxTime{0};
+};
+
+// A cell on the explicit search stack of Solver::SolveCells.
+struct SolverFrame {
+  int cellIndex;
+  int depth;
+  int nextNumber; // the next number to try for the cell
+  std::size_t solutionMark; // size of the partial solution before we filled the cell
+};
+
+// The state of a Solver search that exceeded its budget, to be passed back to Solver::Resume.
+class SolveContinuation {
+public:
+  // The fills of the solution, which is only complete once the search is solved.
+  const std::vector<FillNumberUndoContext>& Solution() const { return solution_; }
+
+private:
+  friend class Solver;
+
+  bool solveBoard_ = false; // whether to go on with the remaining subboards after this one
+  std::vector<FillNumberUndoContext> solution_; // fills before the current search
+  std::vector<const Cell*> cells_;
+  std::vector<SolverFrame> frames_;
+  std::vector<FillNumberUndoContext> searchSolution_;
+  int solutionLimit_ = 1;
+  int solutionsFound_ = 0;
+  int backtrackIndex_ = 0;
+  int minimumDepth_ = 0;
+  int maximumDepth_ = 0;
+};
+
+// Attaches stats to a board for the lifetime of the scope, and restores whatever was attached
+// before afterwards.
+class BoardStatsScope {
+public:
+  BoardStatsScope(ConstrainedBoard& board, SolverStats* stats)
+      : board_{board}, previous_{board.Stats()} {
+    board_.SetStats(stats);
+  }
+
+  ~BoardStatsScope() { board_.SetStats(previous_); }
+
+private:
+  ConstrainedBoard& board_;
+  SolverStats* previous_;
+};
+
 class Solver {
 public:
   Solver(
       bool solveTrivial = true,
       bool verboseLogs = true,
       bool verboseBacktracking = false,
-      bool dumpBoards = false)
+      bool dumpBoards = false,
+      bool dynamicCellOrdering = false)
       : solveTrivial_{solveTrivial},
-        verboseLogs_{verboseLogs},
         verboseBacktracking_{verboseBacktracking},
-        dumpBoards_{dumpBoards} {}
+        dumpSink_{
+            dumpBoards ? static_cast<DumpSink*>(&DefaultHtmlDumpSink()) : &DefaultNullDumpSink()},
+        dynamicCellOrdering_{dynamicCellOrdering},
+        logger_{
+            verboseLogs ? Logger{verboseBacktracking ? LogLevel::kTrace : LogLevel::kDebug}
+                        : Logger::Disabled()},
+        cancel_{nullptr},
+        nodes_{0},
+        maxNodes_{0},
+        hasDeadline_{false} {}
+
+  // Returns the number of search tree nodes the last Solve, SolveCells or Resume call visited.
+  long long NodesVisited() const { return nodes_; }
+
+  // Makes SolveCells give up as soon as the given flag is set, e.g. by another thread.
+  void SetCancellationFlag(const std::atomic<bool>* cancel) { cancel_ = cancel; }
+
+  // Replaces the logger chosen by verboseLogs and verboseBacktracking. Subboard progress is logged
+  // at info level, search depth progress at debug level and backtracks at trace level.
+  void SetLogger(Logger logger) { logger_ = logger; }
+
+  // Replaces the sink chosen by dumpBoards, which receives "maxDepth" events whenever the search
+  // gets deeper than before and "backtrack" events with verboseBacktracking.
+  void SetDumpSink(DumpSink& dumpSink) { dumpSink_ = &dumpSink; }
+
+  // Accumulates statistics about all following searches into the given stats, or stops recording
+  // them if null. The stats must outlive any search they are attached to.
+  void SetStats(SolverStats* stats) { stats_.Attach(stats); }
 
   bool Solve(Board& board) {
     ConstrainedBoard constrainedBoard{board};
@@ -30,36 +115,210 @@ public:
   }
 
   std::vector<FillNumberUndoContext> Solve(ConstrainedBoard& board) {
-    std::vector<FillNumberUndoContext> solution;
+    SolveContinuation continuation;
+    if (Solve(board, SolveBudget{}, continuation) != SolveStatus::kSolved) {
+      return {};
+    }
+    return std::move(continuation.solution_);
+  }
+
+  // Solves the board like Solve, but gives up with kBudgetExceeded once the budget is used up. The
+  // board is then left partially filled and the continuation remembers where the search was, so
+  // that it can be resumed later on the unchanged board. Once solved, the continuation holds the
+  // solution.
+  SolveStatus Solve(
+      ConstrainedBoard& board, const SolveBudget& budget, SolveContinuation& continuation) {
+    BoardStatsScope statsScope{board, stats_.Get()};
+    auto searchTimer = stats_.Time(&SolverStats::searchTime);
+    StartBudget(budget);
+    continuation = SolveContinuation{};
+    continuation.solveBoard_ = true;
 
     if (solveTrivial_) {
       // Solve any initially trivial cells.
-      auto trivialSolution = SolveTrivialCells(board);
-      if (!trivialSolution) {
-        if (verboseLogs_) {
-          std::cout << "Board starting with invalid trivial solution." << std::endl;
+      bool trivialSolved;
+      {
+        auto propagationTimer = stats_.Time(&SolverStats::propagationTime);
+        trivialSolved = SolveTrivialCells(board, continuation.solution_);
+      }
+      if (!trivialSolved) {
+        if (logger_.Enabled(LogLevel::kInfo)) {
+          logger_.Log(LogLevel::kInfo) << "Board starting with invalid trivial solution.";
+        }
+        return SolveStatus::kNoSolution;
+      }
+      if (logger_.Enabled(LogLevel::kInfo) && !continuation.solution_.empty()) {
+        logger_.Log(LogLevel::kInfo)
+            << "Prefilled " << continuation.solution_.size() << " trivial cells.";
+      }
+    }
+
+    return SolveSubboards(board, continuation);
+  }
+
+  // Continues a search that exceeded its budget with a fresh budget.
+  SolveStatus Resume(
+      ConstrainedBoard& board, const SolveBudget& budget, SolveContinuation& continuation) {
+    assert(!continuation.frames_.empty());
+    BoardStatsScope statsScope{board, stats_.Get()};
+    auto searchTimer = stats_.Time(&SolverStats::searchTime);
+    StartBudget(budget);
+    RestoreSearch(continuation);
+    auto status = FinishSubboard(ContinueSearch(board, /* result */ std::nullopt), continuation);
+    if (status == SolveStatus::kSolved && continuation.solveBoard_) {
+      return SolveSubboards(board, continuation);
+    }
+    return status;
+  }
+
+  // Undoes the partial solution of a search that exceeded its budget and won't be resumed.
+  void Abandon(ConstrainedBoard& board, SolveContinuation& continuation) {
+    UndoSolution(board, continuation.searchSolution_);
+    UndoSolution(board, continuation.solution_);
+    continuation = SolveContinuation{};
+  }
+
+  std::optional<std::vector<FillNumberUndoContext>> SolveTrivialCells(ConstrainedBoard& board) {
+    std::vector<FillNumberUndoContext> solution;
+    if (!SolveTrivialCells(board, solution)) {
+      return std::nullopt;
+    }
+    return solution;
+  }
+
+  // Appends the fills for all trivial cells to the given solution. If the trivial cells turn out to
+  // be contradictory, only the fills made here are undone and false is returned.
+  bool SolveTrivialCells(ConstrainedBoard& board, std::vector<FillNumberUndoContext>& solution) {
+    BoardStatsScope statsScope{board, stats_.Get()};
+    std::size_t initialSolutionSize = solution.size();
+    // Trivial cells might change while we fill existing ones, so we make sure to keep checking if
+    // they are empty.
+    while (board.HasTrivialCells()) {
+      auto nextTrivial = board.NextTrivialCell();
+      auto& nextTrivialCell = *nextTrivial.first;
+      int nextTrivialNumber = nextTrivial.second;
+
+      FillNumberUndoContext undo;
+      if (!board.FillNumber(nextTrivialCell, nextTrivialNumber, undo)) {
+        // There aren't supposed to be any conflicts for filling trivial cells, so there must be
+        // contradictory board constraints.
+        while (solution.size() > initialSolutionSize) {
+          board.UndoFillNumber(solution.back());
+          solution.pop_back();
         }
-        return {};
+        return false;
       }
-      solution.insert(solution.end(), trivialSolution->begin(), trivialSolution->end());
-      if (verboseLogs_ && !trivialSolution->empty()) {
-        std::cout << "Prefilled " << trivialSolution->size() << " trivial cells." << std::endl;
+      solution.emplace_back(undo);
+      stats_.Count(&SolverStats::trivialCells);
+    }
+    return true;
+  }
+
+  std::vector<FillNumberUndoContext> SolveCells(
+      ConstrainedBoard& board, std::vector<const Cell*> cells) {
+    SolveContinuation continuation;
+    if (SolveCells(board, std::move(cells), SolveBudget{}, continuation) != SolveStatus::kSolved) {
+      return {};
+    }
+    return std::move(continuation.solution_);
+  }
+
+  // Solves the given cells like SolveCells, but with a budget like the budgeted Solve.
+  SolveStatus SolveCells(
+      ConstrainedBoard& board,
+      std::vector<const Cell*> cells,
+      const SolveBudget& budget,
+      SolveContinuation& continuation) {
+    BoardStatsScope statsScope{board, stats_.Get()};
+    auto searchTimer = stats_.Time(&SolverStats::searchTime);
+    StartBudget(budget);
+    continuation = SolveContinuation{};
+    PrepareSearch(std::move(cells), /* solutionLimit */ 1);
+    return FinishSubboard(SearchCells(board, /* depth */ 0), continuation);
+  }
+
+  int CountSolutions(Board& board, int limit) {
+    ConstrainedBoard constrainedBoard{board};
+    return CountSolutions(constrainedBoard, limit);
+  }
+
+  // Counts the solutions of the board, but stops enumerating once limit solutions were found. A
+  // limit of 2 checks whether the board has a unique solution. The board is left unchanged.
+  int CountSolutions(ConstrainedBoard& board, int limit) {
+    assert(limit > 0);
+    BoardStatsScope statsScope{board, stats_.Get()};
+    auto searchTimer = stats_.Time(&SolverStats::searchTime);
+
+    std::vector<FillNumberUndoContext> trivialSolution;
+    if (solveTrivial_) {
+      auto propagationTimer = stats_.Time(&SolverStats::propagationTime);
+      auto initialTrivialSolution = SolveTrivialCells(board);
+      if (!initialTrivialSolution) {
+        return 0;
       }
+      trivialSolution = std::move(*initialTrivialSolution);
+    }
+
+    // Separate subboards are independent, so the total number of solutions is the product of the
+    // number of solutions of each subboard.
+    int numSolutions = 1;
+    auto freeCells = board.UnderlyingBoard().FindFreeCells();
+    while (!freeCells.empty() && numSolutions > 0) {
+      const auto& cell = **freeCells.begin();
+      auto subboard = board.UnderlyingBoard().FindSubboard(cell);
+      for (const auto* subboardCell : subboard) {
+        freeCells.erase(subboardCell);
+      }
+
+      // Sort cells by number of sum constraints so we solve those with existing constraints first.
+      std::sort(subboard.begin(), subboard.end(), [&](const Cell* a, const Cell* b) {
+        int numSumsA = (board.UnderlyingBoard().RowBlock(*a).rowBlockSum > 0) +
+            (board.UnderlyingBoard().ColumnBlock(*a).columnBlockSum > 0);
+        int numSumsB = (board.UnderlyingBoard().RowBlock(*b).rowBlockSum > 0) +
+            (board.UnderlyingBoard().ColumnBlock(*b).columnBlockSum > 0);
+        return numSumsA > numSumsB;
+      });
+
+      StartBudget(SolveBudget{});
+      PrepareSearch(std::move(subboard), limit);
+      SearchCells(board, /* depth */ 0);
+
+      // If we stopped at the limit, the last solution is still filled in.
+      UndoSolution(board, solution_);
+      solution_.clear();
+
+      long long product = static_cast<long long>(numSolutions) * solutionsFound_;
+      numSolutions = static_cast<int>(std::min(product, static_cast<long long>(limit)));
+    }
+
+    UndoSolution(board, trivialSolution);
+    return numSolutions;
+  }
+
+  void UndoSolution(ConstrainedBoard& board, const std::vector<FillNumberUndoContext>& solution) {
+    for (auto iter = solution.rbegin(); iter != solution.rend(); ++iter) {
+      board.UndoFillNumber(*iter);
     }
+  }
 
+private:
+  // Solves the remaining subboards one after another, appending their solutions to the
+  // continuation's.
+  SolveStatus SolveSubboards(ConstrainedBoard& board, SolveContinuation& continuation) {
     // Need to solve free cells in a loop because there could be multiple separate regions.
     while (true) {
       auto freeCells = board.UnderlyingBoard().FindFreeCells();
       if (freeCells.empty()) {
         // If there are no more free cells, we consider the board solved.
-        return solution;
+        return SolveStatus::kSolved;
       }
 
       const auto& cell = **freeCells.begin();
       auto subboard = board.UnderlyingBoard().FindSubboard(cell);
-      if (verboseLogs_) {
-        std::cout << "Attempting to solve subboard at cell (" << cell.row << ", " << cell.column
-                  << ") with " << subboard.size() << " free cells." << std::endl;
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Attempting to solve subboard at cell (" << cell.row << ", "
+                                     << cell.column << ") with " << subboard.size()
+                                     << " free cells.";
       }
 
       // Sort cells by number of sum constraints so we solve those with existing constraints first.
@@ -71,175 +330,338 @@ public:
         return numSumsA > numSumsB;
       });
 
-      auto subboardSolution = SolveCells(board, subboard);
-      if (subboardSolution.empty()) {
+      PrepareSearch(std::move(subboard), /* solutionLimit */ 1);
+      auto status = FinishSubboard(SearchCells(board, /* depth */ 0), continuation);
+      if (status != SolveStatus::kSolved) {
         // If we cannot solve any individual subboard, then we cannot solve the board as a whole.
-        if (verboseLogs_) {
-          std::cout << "Failed to solve subboard of size " << cells_.size() << " after "
-                    << backtrackIndex_ << " backtracks." << std::endl;
-        }
-
-        return {};
-      }
-
-      if (verboseLogs_) {
-        std::cout << "Solved subboard of size " << cells_.size() << " after " << backtrackIndex_
-                  << " backtracks." << std::endl;
+        return status;
       }
-      solution.insert(solution.end(), subboardSolution.begin(), subboardSolution.end());
     }
   }
 
-  std::optional<std::vector<FillNumberUndoContext>> SolveTrivialCells(ConstrainedBoard& board) {
-    std::vector<FillNumberUndoContext> solution;
-    int numTrivialCells = 0;
-    // Trivial cells might change while we fill existing ones, so we make sure to keep checking if
-    // they are empty.
-    while (!board.TrivialCells().empty()) {
-      auto nextTrivial = board.TrivialCells().begin();
-      auto& nextTrivialCell = *nextTrivial->first;
-      int nextTrivialNumber = nextTrivial->second;
-
-      FillNumberUndoContext undo;
-      if (!board.FillNumber(nextTrivialCell, nextTrivialNumber, undo)) {
-        // There aren't supposed to be any conflicts for filling trivial cells, so there must be
-        // contradictory board constraints.
-        UndoSolution(board, solution);
-        return std::nullopt;
-      }
-      solution.emplace_back(undo);
-      numTrivialCells++;
+  // Hands the search state over to the continuation if we ran out of budget, or appends the
+  // subboard's solution to the continuation's if we solved it.
+  SolveStatus FinishSubboard(SolveStatus status, SolveContinuation& continuation) {
+    bool log = logger_.Enabled(LogLevel::kInfo) && continuation.solveBoard_;
+    switch (status) {
+      case SolveStatus::kSolved:
+        if (log) {
+          logger_.Log(LogLevel::kInfo) << "Solved subboard of size " << cells_.size() << " after "
+                                       << backtrackIndex_ << " backtracks.";
+        }
+        continuation.solution_.insert(
+            continuation.solution_.end(), solution_.begin(), solution_.end());
+        solution_.clear();
+        break;
+      case SolveStatus::kNoSolution:
+        if (log) {
+          logger_.Log(LogLevel::kInfo) << "Failed to solve subboard of size " << cells_.size()
+                                       << " after " << backtrackIndex_ << " backtracks.";
+        }
+        break;
+      case SolveStatus::kBudgetExceeded:
+        if (log) {
+          logger_.Log(LogLevel::kInfo) << "Exceeded budget for subboard of size " << cells_.size()
+                                       << " after " << nodes_ << " nodes and " << backtrackIndex_
+                                       << " backtracks.";
+        }
+        SaveSearch(continuation);
+        break;
     }
-    return solution;
+    return status;
   }
 
-  std::vector<FillNumberUndoContext> SolveCells(
-      ConstrainedBoard& board, std::vector<const Cell*> cells) {
+  void PrepareSearch(std::vector<const Cell*> cells, int solutionLimit) {
     backtrackIndex_ = 0;
     minimumDepth_ = 0;
     maximumDepth_ = 0;
-    cells_ = cells;
+    cells_ = std::move(cells);
     solution_.clear();
-    if (!SolveCells(board, /* depth */ 0)) {
-      return {};
-    }
+    solution_.reserve(cells_.size());
+    solutionLimit_ = solutionLimit;
+    solutionsFound_ = 0;
+  }
 
-    return std::move(solution_);
+  void SaveSearch(SolveContinuation& continuation) {
+    continuation.cells_ = std::move(cells_);
+    continuation.frames_ = std::move(frames_);
+    continuation.searchSolution_ = std::move(solution_);
+    continuation.solutionLimit_ = solutionLimit_;
+    continuation.solutionsFound_ = solutionsFound_;
+    continuation.backtrackIndex_ = backtrackIndex_;
+    continuation.minimumDepth_ = minimumDepth_;
+    continuation.maximumDepth_ = maximumDepth_;
+    cells_.clear();
+    frames_.clear();
+    solution_.clear();
   }
 
-  void UndoSolution(ConstrainedBoard& board, const std::vector<FillNumberUndoContext>& solution) {
-    for (auto iter = solution.rbegin(); iter != solution.rend(); ++iter) {
-      board.UndoFillNumber(*iter);
+  void RestoreSearch(SolveContinuation& continuation) {
+    cells_ = std::move(continuation.cells_);
+    frames_ = std::move(continuation.frames_);
+    solution_ = std::move(continuation.searchSolution_);
+    solutionLimit_ = continuation.solutionLimit_;
+    solutionsFound_ = continuation.solutionsFound_;
+    backtrackIndex_ = continuation.backtrackIndex_;
+    minimumDepth_ = continuation.minimumDepth_;
+    maximumDepth_ = continuation.maximumDepth_;
+    continuation.cells_.clear();
+    continuation.frames_.clear();
+    continuation.searchSolution_.clear();
+  }
+
+  void StartBudget(const SolveBudget& budget) {
+    nodes_ = 0;
+    maxNodes_ = budget.maxNodes;
+    hasDeadline_ = budget.maxTime.count() > 0;
+    if (hasDeadline_) {
+      deadline_ = std::chrono::steady_clock::now() + budget.maxTime;
     }
   }
 
-private:
-  bool SolveCells(ConstrainedBoard& board, int depth) {
-    const Cell& cell = *cells_[depth];
-    assert(!cell.isBlock);
-    auto& cellConstraints = board.Constraints(cell);
+  // Counts a search tree node and checks whether that used up the budget.
+  bool BudgetExceeded() {
+    nodes_++;
+    stats_.Count(&SolverStats::nodes);
+    if (maxNodes_ > 0 && nodes_ > maxNodes_) {
+      return true;
+    }
+
+    // Reading the clock is comparatively expensive, so we only check it every so often.
+    constexpr long long kNodesPerClockCheck = 256;
+    return hasDeadline_ && nodes_ % kNodesPerClockCheck == 0 &&
+        std::chrono::steady_clock::now() >= deadline_;
+  }
+
+  // Picks the free cell with the fewest number candidates (minimum remaining values), breaking ties
+  // by preferring cells whose blocks have the fewest free cells left. Returns nullptr if all cells
+  // are filled.
+  const Cell* ChooseCell(ConstrainedBoard& board) const {
+    const Board& underlyingBoard = board.UnderlyingBoard();
+    const Cell* bestCell = nullptr;
+    int bestCount = 0;
+    int bestTightness = 0;
+    for (const Cell* cellPointer : cells_) {
+      const Cell& cell = *cellPointer;
+      if (!cell.IsFree()) {
+        continue;
+      }
 
-    if (depth < minimumDepth_) {
-      minimumDepth_ = depth;
+      int count = board.Constraints(cell).numberCandidates.Count();
+      int tightness = underlyingBoard.RowBlock(cell).rowBlockFree +
+          underlyingBoard.ColumnBlock(cell).columnBlockFree;
+      if (bestCell == nullptr || count < bestCount ||
+          (count == bestCount && tightness < bestTightness)) {
+        bestCell = &cell;
+        bestCount = count;
+        bestTightness = tightness;
+
+        if (bestCount <= 1) {
+          // Can't do any better than a single candidate (or a contradiction).
+          break;
+        }
+      }
     }
+    return bestCell;
+  }
 
-    if (depth > maximumDepth_) {
-      if (verboseLogs_) {
-        std::cout << "Solver first entering depth " << depth << " / " << cells_.size()
-                  << " at cell (" << cell.row << ", " << cell.column << ")";
-        if (minimumDepth_ < maximumDepth_) {
-          std::cout << " after having backtracked to depth " << minimumDepth_;
+  // Records a solution and returns whether we found enough of them to stop searching.
+  bool FoundSolution() {
+    solutionsFound_++;
+    return solutionsFound_ >= solutionLimit_;
+  }
+
+  // Searches depth-first with an explicit stack of frames instead of recursion, so that deep boards
+  // can't overflow the call stack. Cells that are already filled when we get to them don't get a
+  // frame of their own.
+  SolveStatus SearchCells(ConstrainedBoard& board, int depth) {
+    frames_.clear();
+    frames_.reserve(cells_.size());
+    return ContinueSearch(board, EnterCell(board, depth));
+  }
+
+  // Runs the search loop given the result of the subtree we just finished, or nothing if we just
+  // pushed a new frame. Stops with the search state intact if we run out of budget.
+  SolveStatus ContinueSearch(ConstrainedBoard& board, std::optional<bool> result) {
+    while (true) {
+      if (result) {
+        if (*result) {
+          return SolveStatus::kSolved;
+        }
+        if (frames_.empty()) {
+          return SolveStatus::kNoSolution;
         }
-        std::cout << "." << std::endl;
+
+        // The number we tried for the top frame wasn't actually a solution, so undo the partial
+        // one we have.
+        UndoSolutionToMark(board, frames_.back().solutionMark);
       }
-      maximumDepth_ = depth;
-      minimumDepth_ = depth;
 
-      if (dumpBoards_) {
-        board.Dump("maxDepth", maximumDepth_);
+      if (BudgetExceeded()) {
+        return SolveStatus::kBudgetExceeded;
       }
+
+      result = TryNextNumber(board);
     }
+  }
 
-    if (!cell.IsFree()) {
-      if (depth == cells_.size() - 1) {
-        // We've filled all the cells successfully, this is a solution!
-        return true;
+  // Moves on to the cell at the given depth, skipping cells that are already filled. Returns the
+  // result if the search ends here, or pushes a frame for the cell and returns nothing.
+  std::optional<bool> EnterCell(ConstrainedBoard& board, int depth) {
+    while (true) {
+      if (cancel_ != nullptr && cancel_->load(std::memory_order_relaxed)) {
+        return false;
       }
 
-      // We've solved this cell already, skip straight to the next.
-      return SolveCells(board, depth + 1);
+      const Cell* cellPointer = dynamicCellOrdering_ ? ChooseCell(board) : cells_[depth];
+      if (cellPointer == nullptr) {
+        // There are no free cells left, this is a solution!
+        return FoundSolution();
+      }
+      const Cell& cell = *cellPointer;
+      assert(!cell.isBlock);
+
+      if (depth < minimumDepth_) {
+        minimumDepth_ = depth;
+      }
+
+      if (depth > maximumDepth_) {
+        if (logger_.Enabled(LogLevel::kDebug)) {
+          auto line = logger_.Log(LogLevel::kDebug);
+          line << "Solver first entering depth " << depth << " / " << cells_.size() << " at cell ("
+               << cell.row << ", " << cell.column << ")";
+          if (minimumDepth_ < maximumDepth_) {
+            line << " after having backtracked to depth " << minimumDepth_;
+          }
+          line << ".";
+        }
+        maximumDepth_ = depth;
+        minimumDepth_ = depth;
+
+        dumpSink_->Dump(board, "maxDepth", maximumDepth_);
+      }
+
+      if (!cell.IsFree()) {
+        if (depth == cells_.size() - 1) {
+          // We've filled all the cells successfully, this is a solution!
+          return FoundSolution();
+        }
+
+        // We've solved this cell already, skip straight to the next.
+        depth++;
+        continue;
+      }
+
+      SolverFrame frame;
+      frame.cellIndex = board.UnderlyingBoard().Index(cell);
+      frame.depth = depth;
+      frame.nextNumber = 1;
+      frame.solutionMark = solution_.size();
+      frames_.push_back(frame);
+      return std::nullopt;
     }
+  }
 
-    for (int number = 1; number <= 9; number++) {
+  // Fills the next possible number into the cell of the top frame and enters the next cell. If
+  // there are no numbers left to try, the frame is popped and the search backtracks.
+  std::optional<bool> TryNextNumber(ConstrainedBoard& board) {
+    SolverFrame& frame = frames_.back();
+    const Cell& cell = board.UnderlyingBoard()[frame.cellIndex];
+    auto& cellConstraints = board.Constraints(cell);
+
+    while (frame.nextNumber <= 9) {
+      int number = frame.nextNumber++;
       if (!cellConstraints.numberCandidates.Has(number)) {
         continue;
       }
 
-      int initialSolutionSize = solution_.size();
+      // Filling propagates constraints, and so does solving the trivial cells it leads to.
+      bool filled;
       FillNumberUndoContext undoContext;
-      if (!board.FillNumber(cell, number, undoContext)) {
+      {
+        auto propagationTimer = stats_.Time(&SolverStats::propagationTime);
+        filled = board.FillNumber(cell, number, undoContext);
+      }
+      if (!filled) {
+        stats_.Count(&SolverStats::failedFills);
         continue;
       }
       solution_.emplace_back(undoContext);
+      stats_.Count(&SolverStats::fills);
 
       int numTrivialCells = 0;
       if (solveTrivial_) {
         // Solve any now trivial cells.
-        auto trivialSolution = SolveTrivialCells(board);
-        if (!trivialSolution) {
+        bool trivialSolved;
+        {
+          auto propagationTimer = stats_.Time(&SolverStats::propagationTime);
+          trivialSolved = SolveTrivialCells(board, solution_);
+        }
+        if (!trivialSolved) {
           // Undo the filled number
           board.UndoFillNumber(solution_.back());
           solution_.pop_back();
           // The filled number makes the trivial solution invalid, so it cannot be right.
+          stats_.Count(&SolverStats::failedFills);
           continue;
         }
-        solution_.insert(solution_.end(), trivialSolution->begin(), trivialSolution->end());
-        numTrivialCells = trivialSolution->size();
+        numTrivialCells = solution_.size() - frame.solutionMark - 1;
       }
 
-      if (depth + numTrivialCells == cells_.size() - 1) {
+      if (!dynamicCellOrdering_ && frame.depth + numTrivialCells == cells_.size() - 1) {
         // We've filled all the cells successfully, this is a solution!
-        return true;
-      }
-
-      if (SolveCells(board, depth + 1)) {
-        // All remaining cells were filled successfully, this is a solution!
-        return true;
+        if (FoundSolution()) {
+          return true;
+        }
+        UndoSolutionToMark(board, frame.solutionMark);
+        continue;
       }
 
-      // This wasn't actually a solution, so undo the partial one we have.
-      while (solution_.size() > initialSolutionSize) {
-        auto undo = solution_.back();
-        board.UndoFillNumber(undo);
-        solution_.pop_back();
-      }
+      // Careful, entering the next cell may push a frame and invalidate our reference.
+      return EnterCell(board, frame.depth + 1);
     }
 
     if (verboseBacktracking_) {
-      if (verboseLogs_) {
-        std::cout << "Could not find a solution for cell (" << cell.row << ", " << cell.column
-                  << ") at depth " << depth << ", backtrack index " << backtrackIndex_ << "."
-                  << std::endl;
-      }
-      if (dumpBoards_) {
-        board.Dump("backtrack", backtrackIndex_);
+      if (logger_.Enabled(LogLevel::kTrace)) {
+        logger_.Log(LogLevel::kTrace)
+            << "Could not find a solution for cell (" << cell.row << ", " << cell.column
+            << ") at depth " << frame.depth << ", backtrack index " << backtrackIndex_ << ".";
       }
+      dumpSink_->Dump(board, "backtrack", backtrackIndex_);
     }
     backtrackIndex_++;
 
+    frames_.pop_back();
     return false;
   }
 
+  void UndoSolutionToMark(ConstrainedBoard& board, std::size_t solutionMark) {
+    while (solution_.size() > solutionMark) {
+      board.UndoFillNumber(solution_.back());
+      solution_.pop_back();
+    }
+  }
+
 private:
   bool solveTrivial_;
-  bool verboseLogs_;
   bool verboseBacktracking_;
-  bool dumpBoards_;
+  DumpSink* dumpSink_;
+  bool dynamicCellOrdering_;
+  Logger logger_;
+  const std::atomic<bool>* cancel_;
   std::vector<const Cell*> cells_;
   std::vector<FillNumberUndoContext> solution_;
+  std::vector<SolverFrame> frames_;
+  int solutionLimit_;
+  int solutionsFound_;
   int backtrackIndex_;
   int minimumDepth_; // counts the minimum depth since we last hit current maximum depth
   int maximumDepth_;
+  long long nodes_;
+  long long maxNodes_;
+  bool hasDeadline_;
+  std::chrono::steady_clock::time_point deadline_;
+  StatsRecorder stats_;
 };
 
 } // namespace kakuro
@@ -0,0 +1,100 @@
+#include "solver.h"
+
+#include <benchmark/benchmark.h>
+
+#include "board.h"
+#include "board_generator.h"
+#include "constrained_board.h"
+#include <map>
+#include <random>
+
+using namespace kakuro;
+
+namespace {
+
+// Builds a puzzle with a known solution by filling a generated layout without sums, taking the sums
+// of that filling and emptying the cells again. This is much faster than SumGenerator for large
+// boards, although the puzzles can have many solutions. Solve times of such puzzles vary wildly
+// with the layout, so the seed is fixed to one that solves quickly at every size.
+Board GeneratePuzzle(int size) {
+  std::mt19937 random;
+  random.seed(1);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  Board solution = boardGenerator.Generate(size, size);
+  Solver filler{/* solveTrivial */ true, /* verboseLogs */ false};
+  bool filled = filler.Solve(solution);
+  assert(filled);
+  (void)filled;
+
+  Board puzzle = solution;
+  for (int index = 0; index < puzzle.Rows() * puzzle.Columns(); index++) {
+    const Cell& cell = puzzle[index];
+    if (cell.isBlock) {
+      for (bool isRow : {true, false}) {
+        int sum = 0;
+        solution.ForEachBlockCell(
+            solution[index], isRow, [&sum](const Cell& blockCell) { sum += blockCell.number; });
+        puzzle.SetBlockSum(cell, isRow, sum);
+      }
+    } else {
+      puzzle.SetNumber(cell, 0);
+    }
+  }
+  return puzzle;
+}
+
+// The corpus is generated once per size and shared by all benchmarks.
+const Board& Puzzle(int size) {
+  static std::map<int, Board> puzzles;
+  auto iter = puzzles.find(size);
+  if (iter == puzzles.end()) {
+    iter = puzzles.emplace(size, GeneratePuzzle(size)).first;
+  }
+  return iter->second;
+}
+
+void Undo(ConstrainedBoard& board, const std::vector<FillNumberUndoContext>& fills) {
+  for (auto iter = fills.rbegin(); iter != fills.rend(); ++iter) {
+    board.UndoFillNumber(*iter);
+  }
+}
+
+// Solves the cells that are trivial from the sums alone, and undoes them again.
+void BM_SolveTrivialCells(benchmark::State& state) {
+  Board board = Puzzle(state.range(0));
+  ConstrainedBoard constrainedBoard{board};
+  Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+
+  for (auto _ : state) {
+    auto fills = solver.SolveTrivialCells(constrainedBoard);
+    if (!fills) {
+      state.SkipWithError("Trivial cells conflict");
+      break;
+    }
+    state.counters["fills"] = fills->size();
+    Undo(constrainedBoard, *fills);
+  }
+}
+BENCHMARK(BM_SolveTrivialCells)->Arg(20)->Arg(40)->Arg(60);
+
+// Solves a puzzle of the corpus from scratch, and undoes the solution again.
+void BM_Solve(benchmark::State& state) {
+  Board board = Puzzle(state.range(0));
+  ConstrainedBoard constrainedBoard{board};
+  Solver solver{/* solveTrivial */ true, /* verboseLogs */ false};
+  SolverStats stats;
+  solver.SetStats(&stats);
+
+  for (auto _ : state) {
+    auto solution = solver.Solve(constrainedBoard);
+    if (solution.empty()) {
+      state.SkipWithError("Failed to solve");
+      break;
+    }
+    Undo(constrainedBoard, solution);
+  }
+  state.counters["nodes"] = benchmark::Counter(stats.nodes, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Solve)->DenseRange(10, 60, 10)->Unit(benchmark::kMicrosecond);
+
+} // namespace
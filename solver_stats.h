@@ -0,0 +1,139 @@
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <array>
+#include <chrono>
+#include <ostream>
+
+// Statistics counting is cheap enough to leave on, but can be compiled out entirely by defining
+// KAKURO_SOLVER_STATS to 0.
+#ifndef KAKURO_SOLVER_STATS
+#define KAKURO_SOLVER_STATS 1
+#endif
+
+namespace kakuro {
+
+// The reasons ConstrainedBoard can detect that its constraints are contradictory.
+enum class Contradiction {
+  kNoCandidates, // a free cell has no number candidates left
+  kSumLeftover, // the last free cell of a block would need a number outside of 1-9
+  kNecessaryNumberMissing, // no cell of a block can provide a number its sum needs
+  kSumBounds, // a block's sum is outside the min/max sum of its candidates
+  kNoCombination, // none of a block sum's combinations fit, with combination propagation
+  kConflictingTrivial, // a cell became trivial for two different numbers
+};
+
+constexpr int kNumContradictions = 6;
+
+struct SolverStats {
+  long long nodes = 0;
+  long long fills = 0;
+  long long failedFills = 0;
+  long long trivialCells = 0;
+  std::array<long long, kNumContradictions> contradictions{};
+  std::chrono::nanoseconds propagationTime{0};
+  std::chrono::nanoseconds searchTime{0}; // includes propagationTime
+
+  void WriteJson(std::ostream& output) const {
+    static constexpr std::array<const char*, kNumContradictions> kContradictionNames{
+        "noCandidates",
+        "sumLeftover",
+        "necessaryNumberMissing",
+        "sumBounds",
+        "noCombination",
+        "conflictingTrivial"};
+
+    output << "{\n";
+    output << "  \"nodes\": " << nodes << ",\n";
+    output << "  \"fills\": " << fills << ",\n";
+    output << "  \"failedFills\": " << failedFills << ",\n";
+    output << "  \"trivialCells\": " << trivialCells << ",\n";
+    output << "  \"contradictions\": {";
+    for (int i = 0; i < kNumContradictions; i++) {
+      output << (i > 0 ? ", " : "") << "\"" << kContradictionNames[i]
+             << "\": " << contradictions[i];
+    }
+    output << "},\n";
+    output << "  \"propagationSeconds\": " << std::chrono::duration<double>(propagationTime).count()
+           << ",\n";
+    output << "  \"searchSeconds\": "
+           << std::chrono::duration<double>(searchTime - propagationTime).count() << "\n";
+    output << "}\n";
+  }
+};
+
+// Records into an attached SolverStats, and does nothing if none is attached or stats are compiled
+// out.
+class StatsRecorder {
+public:
+  // Adds the time from its construction to its destruction to a SolverStats timer.
+  class ScopedTimer {
+  public:
+#if KAKURO_SOLVER_STATS
+    ScopedTimer(std::chrono::nanoseconds* time)
+        : time_{time},
+          start_{time != nullptr ? std::chrono::steady_clock::now()
+                                 : std::chrono::steady_clock::time_point{}} {}
+
+    ~ScopedTimer() {
+      if (time_ != nullptr) {
+        *time_ += std::chrono::steady_clock::now() - start_;
+      }
+    }
+
+  private:
+    std::chrono::nanoseconds* time_;
+    std::chrono::steady_clock::time_point start_;
+#else
+    // Keeps timers from being flagged as unused variables when stats are compiled out.
+    ~ScopedTimer() {}
+#endif
+  };
+
+  void Attach(SolverStats* stats) {
+#if KAKURO_SOLVER_STATS
+    stats_ = stats;
+#endif
+  }
+
+  SolverStats* Get() const {
+#if KAKURO_SOLVER_STATS
+    return stats_;
+#else
+    return nullptr;
+#endif
+  }
+
+  void Count(long long SolverStats::*counter) {
+#if KAKURO_SOLVER_STATS
+    if (stats_ != nullptr) {
+      (stats_->*counter)++;
+    }
+#endif
+  }
+
+  void CountContradiction(Contradiction cause) {
+#if KAKURO_SOLVER_STATS
+    if (stats_ != nullptr) {
+      stats_->contradictions[static_cast<int>(cause)]++;
+    }
+#endif
+  }
+
+  ScopedTimer Time(std::chrono::nanoseconds SolverStats::*timer) {
+#if KAKURO_SOLVER_STATS
+    return ScopedTimer{stats_ != nullptr ? &(stats_->*timer) : nullptr};
+#else
+    return ScopedTimer{};
+#endif
+  }
+
+private:
+#if KAKURO_SOLVER_STATS
+  SolverStats* stats_ = nullptr;
+#endif
+};
+
+} // namespace kakuro
+
+#endif
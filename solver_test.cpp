@@ -11,11 +11,22 @@ using namespace kakuro;
 using testing::IsEmpty;
 using testing::Not;
 
-class SolverTest : public ::testing::TestWithParam<bool> {};
+// Parameterized by whether to solve trivial cells and whether to use dynamic cell ordering.
+class SolverTest : public ::testing::TestWithParam<std::tuple<bool, bool>> {
+protected:
+  Solver CreateSolver() const {
+    return Solver{
+        /* solveTrivial */ std::get<0>(GetParam()),
+        /* verboseLogs */ true,
+        /* verboseBacktracking */ false,
+        /* dumpBoards */ false,
+        /* dynamicCellOrdering */ std::get<1>(GetParam())};
+  }
+};
 
 TEST_P(SolverTest, SolveEmpty) {
   Board board{3, 4};
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
   bool solved = solver.Solve(board);
   ASSERT_TRUE(solved);
 
@@ -42,7 +53,7 @@ TEST_P(SolverTest, SolveConstrained) {
   ConstrainedBoard constrainedBoard{board};
   SetSumUndoContext sumUndo;
   constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 17, sumUndo);
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
   auto result = solver.Solve(constrainedBoard);
   ASSERT_THAT(result, Not(IsEmpty()));
 
@@ -58,7 +69,7 @@ TEST_P(SolverTest, SolveUnique) {
   constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 10, sumUndo);
   constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 13, sumUndo);
   constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 8, sumUndo);
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
   auto result = solver.Solve(constrainedBoard);
   ASSERT_THAT(result, Not(IsEmpty()));
 
@@ -79,9 +90,37 @@ TEST_P(SolverTest, SolveImpossible) {
   constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 5, sumUndo);
   constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 5, sumUndo);
   constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 5, sumUndo);
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
+  auto result = solver.Solve(constrainedBoard);
+  ASSERT_THAT(result, IsEmpty());
+}
+
+TEST_P(SolverTest, SolveImpossibleStats) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 5, sumUndo);
+  SolverStats stats;
+  Solver solver = CreateSolver();
+  solver.SetStats(&stats);
   auto result = solver.Solve(constrainedBoard);
   ASSERT_THAT(result, IsEmpty());
+
+#if KAKURO_SOLVER_STATS
+  ASSERT_GT(stats.nodes, 0);
+  ASSERT_GT(stats.fills + stats.failedFills, 0);
+  long long numContradictions = 0;
+  for (long long count : stats.contradictions) {
+    numContradictions += count;
+  }
+  ASSERT_GT(numContradictions, 0);
+  ASSERT_LE(stats.propagationTime, stats.searchTime);
+  ASSERT_EQ(constrainedBoard.Stats(), nullptr) << "stats must only be attached while solving";
+#endif
 }
 
 TEST_P(SolverTest, SolveStar) {
@@ -95,7 +134,7 @@ TEST_P(SolverTest, SolveStar) {
   constrainedBoard.SetBlockSum(board(1, 1), /* isRow */ true, 1, sumUndo);
   constrainedBoard.SetBlockSum(board(1, 3), /* isRow */ false, 1, sumUndo);
 
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
   auto result = solver.Solve(constrainedBoard);
   ASSERT_THAT(result, Not(IsEmpty()));
 }
@@ -108,12 +147,175 @@ TEST_P(SolverTest, SolveGenerated) {
   BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
   auto board = boardGenerator.Generate(/* rows */ 10, /* columns */ 20);
 
-  Solver solver{GetParam()};
+  Solver solver = CreateSolver();
   bool solved = solver.Solve(board);
   ASSERT_TRUE(solved);
 }
 
-INSTANTIATE_TEST_SUITE_P(WithWithoutTrivial, SolverTest, testing::Values(true));
+TEST_P(SolverTest, CountSolutions) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  Solver solver = CreateSolver();
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 2), 2);
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 100), 100);
+
+  // 7 = 1 + 2 + 4, so there are 3! ways to fill the row.
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 7, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 24, sumUndo);
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 100), 36);
+
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 10, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 13, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 8, sumUndo);
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 2), 1);
+
+  // Counting must leave the board as it was.
+  for (int row = 1; row <= 2; row++) {
+    for (int col = 1; col <= 3; col++) {
+      ASSERT_TRUE(board(row, col).IsFree());
+    }
+  }
+  ASSERT_THAT(solver.Solve(constrainedBoard), Not(IsEmpty()));
+}
+
+TEST_P(SolverTest, CountSolutionsImpossible) {
+  Board board{3, 4};
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 6, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 3), /* isRow */ false, 5, sumUndo);
+  Solver solver = CreateSolver();
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 2), 0);
+}
+
+TEST_P(SolverTest, CountSolutionsSeparateSubboards) {
+  // The two free cells in the bottom right are separated from the rest of the board.
+  Board board{4, 4};
+  board.MakeBlock(board(1, 3));
+  board.MakeBlock(board(2, 3));
+  board.MakeBlock(board(3, 1));
+  board.MakeBlock(board(3, 2));
+  ConstrainedBoard constrainedBoard{board};
+  SetSumUndoContext sumUndo;
+  constrainedBoard.SetBlockSum(board(1, 0), /* isRow */ true, 3, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 0), /* isRow */ true, 4, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 1), /* isRow */ false, 4, sumUndo);
+  constrainedBoard.SetBlockSum(board(0, 2), /* isRow */ false, 3, sumUndo);
+  Solver solver = CreateSolver();
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 100), 9);
+
+  constrainedBoard.SetBlockSum(board(3, 2), /* isRow */ true, 5, sumUndo);
+  constrainedBoard.SetBlockSum(board(2, 3), /* isRow */ false, 5, sumUndo);
+  ASSERT_EQ(solver.CountSolutions(constrainedBoard, /* limit */ 2), 1);
+}
+
+TEST_P(SolverTest, CountSolutionsCombinationPropagation) {
+  std::mt19937 random;
+  random.seed(3);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  auto board = boardGenerator.Generate(/* rows */ 6, /* columns */ 8);
+  Solver solver = CreateSolver();
+  ASSERT_TRUE(solver.Solve(board));
+
+  // Turn the solution into block sums and clear its numbers again.
+  std::vector<std::tuple<const Cell*, bool, int>> sums;
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      const Cell& cell = board(row, column);
+      for (bool isRow : {true, false}) {
+        if (cell.isBlock && cell.BlockSize(isRow) > 0) {
+          int sum = 0;
+          board.ForEachBlockCell(
+              cell, isRow, [&sum](const Cell& currentCell) { sum += currentCell.number; });
+          sums.emplace_back(&cell, isRow, sum);
+        }
+      }
+    }
+  }
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      if (!board(row, column).isBlock) {
+        board.SetNumber(board(row, column), 0);
+      }
+    }
+  }
+
+  // Both propagation modes must agree on the number of solutions after each sum we set.
+  Board otherBoard{board};
+  ConstrainedBoard constrainedBoard{board};
+  ConstrainedBoard combinationBoard{otherBoard, /* combinationPropagation */ true};
+  for (const auto& [cell, isRow, sum] : sums) {
+    SetSumUndoContext sumUndo;
+    ASSERT_TRUE(constrainedBoard.SetBlockSum(*cell, isRow, sum, sumUndo));
+    const Cell& otherCell = otherBoard(cell->row, cell->column);
+    ASSERT_TRUE(combinationBoard.SetBlockSum(otherCell, isRow, sum, sumUndo));
+    ASSERT_EQ(
+        solver.CountSolutions(combinationBoard, /* limit */ 20),
+        solver.CountSolutions(constrainedBoard, /* limit */ 20));
+  }
+}
+
+TEST_P(SolverTest, SolveWithNodeBudget) {
+  std::mt19937 random;
+  random.seed(3);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  auto board = boardGenerator.Generate(/* rows */ 10, /* columns */ 20);
+  Board expectedBoard{board};
+  Solver solver = CreateSolver();
+  ASSERT_TRUE(solver.Solve(expectedBoard));
+
+  ConstrainedBoard constrainedBoard{board};
+  SolveBudget budget;
+  budget.maxNodes = 10;
+  SolveContinuation continuation;
+  auto status = solver.Solve(constrainedBoard, budget, continuation);
+  int numResumes = 0;
+  while (status == SolveStatus::kBudgetExceeded) {
+    status = solver.Resume(constrainedBoard, budget, continuation);
+    numResumes++;
+  }
+  ASSERT_EQ(status, SolveStatus::kSolved);
+  ASSERT_GT(numResumes, 0);
+  ASSERT_THAT(continuation.Solution(), Not(IsEmpty()));
+
+  // Resuming must find the same solution as solving in one go.
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      ASSERT_EQ(board(row, column).number, expectedBoard(row, column).number);
+    }
+  }
+}
+
+TEST_P(SolverTest, AbandonBudgetExceeded) {
+  std::mt19937 random;
+  random.seed(3);
+  BoardGenerator boardGenerator{random, /* blockProbability */ 0.3};
+  auto board = boardGenerator.Generate(/* rows */ 10, /* columns */ 20);
+  ConstrainedBoard constrainedBoard{board};
+
+  Solver solver = CreateSolver();
+  SolveBudget budget;
+  budget.maxNodes = 5;
+  SolveContinuation continuation;
+  ASSERT_EQ(solver.Solve(constrainedBoard, budget, continuation), SolveStatus::kBudgetExceeded);
+
+  solver.Abandon(constrainedBoard, continuation);
+  for (int row = 0; row < board.Rows(); row++) {
+    for (int column = 0; column < board.Columns(); column++) {
+      ASSERT_TRUE(board(row, column).isBlock || board(row, column).IsFree());
+    }
+  }
+  ASSERT_FALSE(constrainedBoard.HasTrivialCells());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    WithWithoutTrivial,
+    SolverTest,
+    testing::Combine(testing::Values(true), testing::Bool()));
 
 
 TEST(SolverTest, SolveInvalidTrivial) {
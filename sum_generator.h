@@ -3,8 +3,12 @@
 
 #include "board.h"
 #include "combinations.h"
+#include "dump_sink.h"
+#include "logger.h"
 #include "solver.h"
+#include <chrono>
 #include <fstream>
+#include <optional>
 #include <random>
 #include <unordered_set>
 
@@ -14,20 +18,47 @@ class SumGenerator {
 public:
   SumGenerator(bool verboseLogs = true)
       : solver_{/* solveTrivial */ true, false, false, false},
-        verboseLogs_{verboseLogs},
-        attempt_{0} {}
+        logger_{verboseLogs ? Logger{LogLevel::kDebug} : Logger::Disabled()},
+        dumpSink_{&DefaultNullDumpSink()},
+        attempt_{0},
+        nodesUsed_{0},
+        budgetExceeded_{false} {}
+
+  // Replaces the logger chosen by verboseLogs. Subboard progress is logged at info level, chosen
+  // sums at debug level and every attempted sum at trace level.
+  void SetLogger(Logger logger) { logger_ = logger; }
+
+  // Makes the sink receive a "choose" event for every attempted block sum.
+  void SetDumpSink(DumpSink& dumpSink) { dumpSink_ = &dumpSink; }
+
+  // Records statistics about the searches used to verify the chosen sums.
+  void SetStats(SolverStats* stats) { solver_.SetStats(stats); }
+
+  // Limits the searches of each GenerateSums call to the given nodes and time in total, after which
+  // it gives up. Zero means unlimited, which is the default.
+  void SetBudget(const SolveBudget& budget) { budget_ = budget; }
+
+  // Returns whether the last GenerateSums call failed because it ran out of budget, rather than
+  // because the board has no solution.
+  bool BudgetExceeded() const { return budgetExceeded_; }
 
   bool GenerateSums(ConstrainedBoard& board) {
+    nodesUsed_ = 0;
+    budgetExceeded_ = false;
+    if (budget_.maxTime.count() > 0) {
+      deadline_ = std::chrono::steady_clock::now() + budget_.maxTime;
+    }
+
     // Solve any initially trivial cells.
     auto trivialSolution = solver_.SolveTrivialCells(board);
     if (!trivialSolution) {
-      if (verboseLogs_) {
-        std::cout << "Board starting with invalid trivial solution." << std::endl;
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Board starting with invalid trivial solution.";
       }
       return false;
     }
-    if (verboseLogs_ && !trivialSolution->empty()) {
-      std::cout << "Prefilled " << trivialSolution->size() << " trivial cells." << std::endl;
+    if (logger_.Enabled(LogLevel::kInfo) && !trivialSolution->empty()) {
+      logger_.Log(LogLevel::kInfo) << "Prefilled " << trivialSolution->size() << " trivial cells.";
     }
 
     while (true) {
@@ -40,58 +71,72 @@ public:
       auto& cell = **freeCells.begin();
       cells_ = board.UnderlyingBoard().FindSubboard(cell);
 
-      if (verboseLogs_) {
-        std::cout << "Verifying solvability for subboard at cell (" << cell.row << ", "
-                  << cell.column << ") with " << cells_.size() << " free cells." << std::endl;
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Verifying solvability for subboard at cell (" << cell.row
+                                     << ", " << cell.column << ") with " << cells_.size()
+                                     << " free cells.";
       }
 
       // First check if the board is solvable
-      auto solution = solver_.SolveCells(board, cells_);
-      if (solution.empty()) {
-        if (verboseLogs_) {
-          std::cout << "Encountered unsolvable subboard at cell (" << cell.row << ", "
-                    << cell.column << ") with " << cells_.size() << " free cells." << std::endl;
+      auto solution = SolveCells(board);
+      if (!solution) {
+        return false;
+      }
+      if (solution->empty()) {
+        if (logger_.Enabled(LogLevel::kInfo)) {
+          logger_.Log(LogLevel::kInfo) << "Encountered unsolvable subboard at cell (" << cell.row
+                                       << ", " << cell.column << ") with " << cells_.size()
+                                       << " free cells.";
         }
         return false;
       }
-      solver_.UndoSolution(board, solution);
+      solver_.UndoSolution(board, *solution);
 
       blocks_ = board.UnderlyingBoard().FindSubboardBlocks(cells_);
-      if (verboseLogs_) {
-        std::cout << "Generating sums for subboard at cell (" << cell.row << ", " << cell.column
-                  << ") with " << cells_.size() << " free cells and " << blocks_.size()
-                  << " blocks." << std::endl;
+      if (logger_.Enabled(LogLevel::kInfo)) {
+        logger_.Log(LogLevel::kInfo) << "Generating sums for subboard at cell (" << cell.row << ", "
+                                     << cell.column << ") with " << cells_.size()
+                                     << " free cells and " << blocks_.size() << " blocks.";
+      }
+      if (!GenerateSubboardSums(board)) {
+        return false;
       }
-      GenerateSubboardSums(board);
 
-      solution = solver_.SolveCells(board, cells_);
-      assert(solution.size() == cells_.size());
+      solution = SolveCells(board);
+      if (!solution) {
+        return false;
+      }
+      assert(solution->size() == cells_.size());
     }
   }
 
 private:
-  // Precondition: subboard must be solvable
-  void GenerateSubboardSums(ConstrainedBoard& board) {
+  // Precondition: subboard must be solvable, so this only fails if the budget is exceeded.
+  bool GenerateSubboardSums(ConstrainedBoard& board) {
     while (!blocks_.empty()) {
       const auto& cell = **blocks_.begin();
 
       if (cell.rowBlockSize > 0 && cell.rowBlockSum == 0) {
-        bool chosen = ChooseBlockSum(board, /* isRow */ true, cell);
-        assert(chosen); // cannot fail because our precondition is that the subboard is solvable
+        if (!ChooseBlockSum(board, /* isRow */ true, cell)) {
+          assert(budgetExceeded_);
+          return false;
+        }
 
-        if (verboseLogs_) {
-          std::cout << "Chose row block sum " << cell.rowBlockSum << " for cell (" << cell.row
-                    << ", " << cell.column << ")." << std::endl;
+        if (logger_.Enabled(LogLevel::kDebug)) {
+          logger_.Log(LogLevel::kDebug) << "Chose row block sum " << cell.rowBlockSum
+                                        << " for cell (" << cell.row << ", " << cell.column << ").";
         }
       }
 
       if (cell.columnBlockSize > 0 && cell.columnBlockSum == 0) {
-        bool chosen = ChooseBlockSum(board, /* isRow */ false, cell);
-        assert(chosen); // cannot fail because our precondition is that the subboard is solvable
+        if (!ChooseBlockSum(board, /* isRow */ false, cell)) {
+          assert(budgetExceeded_);
+          return false;
+        }
 
-        if (verboseLogs_) {
-          std::cout << "Chose column block sum " << cell.columnBlockSum << " for cell (" << cell.row
-                    << ", " << cell.column << ")." << std::endl;
+        if (logger_.Enabled(LogLevel::kDebug)) {
+          logger_.Log(LogLevel::kDebug) << "Chose column block sum " << cell.columnBlockSum
+                                        << " for cell (" << cell.row << ", " << cell.column << ").";
         }
       }
 
@@ -111,6 +156,7 @@ private:
             board.Constraints(*b).numberCandidates.Count();
       });
     }
+    return true;
   }
 
   bool ChooseBlockSum(ConstrainedBoard& board, bool isRow, const Cell& cell) {
@@ -135,10 +181,12 @@ private:
         continue;
       }
 
-      std::cout << "Attempting to set " << (isRow ? "row" : "column") << " block (" << cell.row
-                << ", " << cell.column << ") to sum " << sum << ": " << attempt_ << "."
-                << std::endl;
-      board.Dump("choose", attempt_++);
+      if (logger_.Enabled(LogLevel::kTrace)) {
+        logger_.Log(LogLevel::kTrace) << "Attempting to set " << (isRow ? "row" : "column")
+                                      << " block (" << cell.row << ", " << cell.column
+                                      << ") to sum " << sum << ": " << attempt_ << ".";
+      }
+      dumpSink_->Dump(board, "choose", attempt_++);
 
       auto trivialSolution = solver_.SolveTrivialCells(board);
       if (!trivialSolution) {
@@ -147,15 +195,20 @@ private:
         continue;
       }
 
-      auto solution = solver_.SolveCells(board, cells_);
+      auto solution = SolveCells(board);
+      if (!solution) {
+        solver_.UndoSolution(board, *trivialSolution);
+        board.UndoSetSum(undo);
+        return false;
+      }
 
-      if (trivialSolution->size() + solution.size() == cells_.size()) {
+      if (trivialSolution->size() + solution->size() == cells_.size()) {
         // This sum works, so let's undo the solution and return.
-        solver_.UndoSolution(board, solution);
+        solver_.UndoSolution(board, *solution);
         solver_.UndoSolution(board, *trivialSolution);
         return true;
       }
-      assert(solution.empty());
+      assert(solution->empty());
 
       // Always undo the trivial solution
       solver_.UndoSolution(board, *trivialSolution);
@@ -165,11 +218,51 @@ private:
     return false;
   }
 
+  // Solves the current subboard with what is left of the budget. Returns an empty solution if it
+  // has none, or nothing if the budget ran out, in which case the board is left as it was.
+  std::optional<std::vector<FillNumberUndoContext>> SolveCells(ConstrainedBoard& board) {
+    SolveBudget budget;
+    if (budget_.maxNodes > 0) {
+      budget.maxNodes = budget_.maxNodes - nodesUsed_;
+      if (budget.maxNodes <= 0) {
+        budgetExceeded_ = true;
+        return std::nullopt;
+      }
+    }
+    if (budget_.maxTime.count() > 0) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline_ - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0) {
+        budgetExceeded_ = true;
+        return std::nullopt;
+      }
+      budget.maxTime = remaining;
+    }
+
+    SolveContinuation continuation;
+    auto status = solver_.SolveCells(board, cells_, budget, continuation);
+    nodesUsed_ += solver_.NodesVisited();
+    if (status == SolveStatus::kBudgetExceeded) {
+      solver_.Abandon(board, continuation);
+      budgetExceeded_ = true;
+      return std::nullopt;
+    }
+    if (status == SolveStatus::kNoSolution) {
+      return std::vector<FillNumberUndoContext>{};
+    }
+    return continuation.Solution();
+  }
+
   Solver solver_;
-  bool verboseLogs_;
+  Logger logger_;
   std::vector<const Cell*> cells_;
   std::unordered_set<const Cell*> blocks_;
+  DumpSink* dumpSink_;
   int attempt_;
+  SolveBudget budget_;
+  long long nodesUsed_;
+  std::chrono::steady_clock::time_point deadline_;
+  bool budgetExceeded_;
 };
 
 } // namespace kakuro
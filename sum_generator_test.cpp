@@ -19,3 +19,26 @@ TEST(SumGeneratorTest, GenerateStar) {
   bool result = sumGenerator.GenerateSums(constrainedBoard);
   ASSERT_TRUE(result);
 }
+
+TEST(SumGeneratorTest, Budget) {
+  Board board{8, 8};
+  ConstrainedBoard constrainedBoard{board};
+
+  SumGenerator sumGenerator{/* verboseLogs */ false};
+  SolveBudget budget;
+  budget.maxNodes = 1;
+  sumGenerator.SetBudget(budget);
+  ASSERT_FALSE(sumGenerator.GenerateSums(constrainedBoard));
+  ASSERT_TRUE(sumGenerator.BudgetExceeded());
+
+  Board starBoard{4, 4};
+  starBoard.MakeBlock(starBoard(1, 1));
+  starBoard.MakeBlock(starBoard(1, 3));
+  starBoard.MakeBlock(starBoard(3, 1));
+  starBoard.MakeBlock(starBoard(3, 3));
+  ConstrainedBoard constrainedStarBoard{starBoard};
+  budget.maxNodes = 100000;
+  sumGenerator.SetBudget(budget);
+  ASSERT_TRUE(sumGenerator.GenerateSums(constrainedStarBoard));
+  ASSERT_FALSE(sumGenerator.BudgetExceeded());
+}